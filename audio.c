@@ -0,0 +1,738 @@
+// getting the clicks out of a sound card (through miniaudio or jack), measuring its latency, and following the beat the input hears
+#include "metronome.h"
+
+// called once, from the audio thread, before it renders anything
+void wrzPrepareAudioThread(wrzAudioOutput * out) {
+#ifndef _WIN32
+    // touch the stack now and keep it in ram, so the first deep call in the callback doesn't take a page fault
+    volatile char stack[WRZ_STACK_PREFAULT];
+    for(int i = 0; i < WRZ_STACK_PREFAULT; i += 4096) stack[i] = 0;
+    if(out->realtime) mlock((const void *) stack, WRZ_STACK_PREFAULT);
+
+    if(!out->realtime) return;
+
+    // miniaudio was asked for a real-time thread already, but it quietly falls back to a normal one if that isn't allowed
+    int policy;
+    struct sched_param param;
+    pthread_getschedparam(pthread_self(), &policy, &param);
+
+    if(policy != SCHED_FIFO && policy != SCHED_RR) {
+        param.sched_priority = WRZ_RT_PRIORITY;
+        if(param.sched_priority > sched_get_priority_max(SCHED_FIFO)) param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+        policy = (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) ? SCHED_FIFO : SCHED_OTHER;
+    }
+
+    atomic_store(&out->realtime_status, (policy == SCHED_FIFO || policy == SCHED_RR) ? 1 : -1); // no printf() on this thread
+#else
+    // on windows miniaudio's realtime priority is all there is, and it doesn't fail
+    if(out->realtime) atomic_store(&out->realtime_status, 1);
+#endif
+}
+
+// keeps everything the audio thread reads out of swap, so a click never has to wait on the disk
+void wrzLockAudioMemory(wrzBeatSounds * sounds, wrzClickEngine * engine, wrzAudioOutput * out) {
+#ifndef _WIN32
+    int arena_frames = 0;
+    for(int i = 0; i < sounds->count; i++) arena_frames += sounds->samples[i].frame_count;
+
+    bool locked = mlock(sounds->arena, (arena_frames > 0 ? arena_frames : 1) * sizeof(float)) == 0;
+    locked = (mlock(sounds->samples, sounds->count * sizeof(wrzBeatSample)) == 0) && locked;
+    locked = (mlock(engine, sizeof(wrzClickEngine)) == 0) && locked;
+    locked = (mlock(out, sizeof(wrzAudioOutput)) == 0) && locked;
+
+    if(locked) printf("INFO: AUDIO: Locked %.1f KiB of samples and engine state in memory.\n", (arena_frames * sizeof(float) + sizeof(wrzClickEngine) + sizeof(wrzAudioOutput)) / 1024.0f);
+    else printf("WARNING: AUDIO: Could not lock the audio memory, raise `ulimit -l` to allow it. Carrying on without.\n");
+#else
+    printf("WARNING: AUDIO: Memory locking is not supported on this platform.\n");
+#endif
+}
+
+void wrzAudioOutputCallback(ma_device * device, void * output, const void * input, ma_uint32 frames) {
+    wrzAudioOutput * out = (wrzAudioOutput *) device->pUserData;
+    (void) input; // playback only
+
+    if(!out->thread_prepared) {
+        wrzPrepareAudioThread(out);
+        wrzCountAllocations(&wrz_counters.audio.allocations);
+        wrzTraceThread("audio");
+        out->thread_prepared = true;
+    }
+
+    double now = wrzNow();
+
+    // the backends recover from underruns on their own without telling anyone, but if the gap since the last callback is longer
+    // than everything the device had queued up, it must have run dry in between
+    if(out->last_callback_time > 0.0 && (now - out->last_callback_time) > (double) out->period_frames * out->periods / WRZ_SAMPLE_RATE) {
+        atomic_fetch_add(&wrz_counters.audio.underruns, 1);
+    }
+    out->last_callback_time = now;
+
+    long long allocations = atomic_load_explicit(&wrz_counters.audio.allocations, memory_order_relaxed); // only this thread writes it
+
+    out->engine->block_time = now + out->latency; // for midi, which has to come out at the same time as the audio
+    wrzRenderClicks(out->engine, (float *) output, frames);
+
+    if(atomic_load_explicit(&wrz_counters.audio.allocations, memory_order_relaxed) != allocations) atomic_fetch_add(&wrz_counters.audio.allocating_callbacks, 1);
+
+    double end = wrzNow();
+    wrzTraceRecord("audio callback", 'X', now, end, "frames", frames);
+
+    double took = (end - now) * 1000.0;
+    wrzRecordStat(&wrz_counters.audio.callback_time, took);
+    wrzRecordStat(&wrz_counters.audio.deadline_margin, (frames * 1000.0) / WRZ_SAMPLE_RATE - took);
+}
+
+typedef struct {
+    const char * name;
+    ma_backend backend;
+} wrzAudioBackendName;
+
+// what AUDIOBACKEND and --audio-backend accept, see wrzFindAudioBackend()
+// there is no pipewire backend in miniaudio, but pipewire speaks the pulseaudio protocol (and alsa, through pipewire-alsa), so that is what it means here
+const wrzAudioBackendName wrz_audio_backends[] = {
+    { "alsa", ma_backend_alsa }, { "pulseaudio", ma_backend_pulseaudio }, { "pipewire", ma_backend_pulseaudio }, { "jack", ma_backend_jack },
+    { "oss", ma_backend_oss }, { "sndio", ma_backend_sndio }, { "audio4", ma_backend_audio4 },
+    { "wasapi", ma_backend_wasapi }, { "dsound", ma_backend_dsound }, { "winmm", ma_backend_winmm },
+    { "coreaudio", ma_backend_coreaudio }, { "null", ma_backend_null },
+};
+
+// false if `name` is NULL, or not a backend, or one that wasn't compiled into raylib's miniaudio, in which case any backend will do
+bool wrzFindAudioBackend(const char * name, ma_backend * backend) {
+    if(name == NULL) return false;
+
+    for(int i = 0; i < (int) (sizeof(wrz_audio_backends) / sizeof(wrz_audio_backends[0])); i++) {
+        if(strcmp(name, wrz_audio_backends[i].name) != 0) continue;
+
+        if(!ma_is_backend_enabled(wrz_audio_backends[i].backend)) {
+            // raylib builds miniaudio with MA_NO_JACK, for one
+            printf("WARNING: AUDIO: The %s backend is not built into this copy of miniaudio, using the first one that works instead.\n", name);
+            return false;
+        }
+
+        *backend = wrz_audio_backends[i].backend;
+        return true;
+    }
+
+    printf("WARNING: AUDIO: Unknown audio backend \"%s\", using the first one that works instead.\n", name);
+    return false;
+}
+
+// opens the default playback device with `periods` periods of `period_frames` each (0 for the backend's default) and starts pulling from `engine`
+// with `realtime`, the device thread is started with real-time priority
+// returns false if there is no device to be had
+// `backend_name` is from AUDIOBACKEND or --audio-backend, NULL to let miniaudio go down its list until one works
+bool wrzOpenAudioOutput(wrzAudioOutput * out, wrzClickEngine * engine, const char * backend_name, int period_frames, int periods, bool realtime, float calibrated_latency_ms) {
+    out->engine = engine;
+    out->jack = false;
+    out->follow_transport = false;
+    atomic_store(&out->transport_rolling, 0);
+    out->realtime = realtime;
+    out->last_callback_time = 0.0;
+    out->thread_prepared = false;
+    atomic_store(&out->realtime_status, 0);
+
+    ma_context_config context_config = ma_context_config_init();
+    context_config.threadPriority = realtime ? ma_thread_priority_realtime : ma_thread_priority_highest;
+
+    ma_backend backend;
+    bool chosen = wrzFindAudioBackend(backend_name, &backend);
+
+    if(chosen && ma_context_init(&backend, 1, &context_config, &out->context) != MA_SUCCESS) {
+        printf("WARNING: AUDIO: Could not initialize the %s backend, trying the rest.\n", backend_name);
+        chosen = false;
+    }
+
+    if(!chosen && ma_context_init(NULL, 0, &context_config, &out->context) != MA_SUCCESS) {
+        printf("ERROR: AUDIO: Could not initialize any audio backend!\n");
+        return false;
+    }
+
+    ma_device_config device_config = ma_device_config_init(ma_device_type_playback);
+    device_config.playback.format = ma_format_f32;
+    device_config.playback.channels = 2;
+    device_config.sampleRate = WRZ_SAMPLE_RATE;
+    device_config.periodSizeInFrames = (period_frames > 0) ? period_frames : 0;
+    device_config.periods = (periods > 0) ? periods : 0;
+    device_config.performanceProfile = ma_performance_profile_low_latency;
+    device_config.noPreSilencedOutputBuffer = MA_TRUE; // wrzRenderClicks() overwrites the whole buffer anyway
+    device_config.noFixedSizedCallback = MA_TRUE; // don't add another buffer in front of the device just to keep the callback size constant
+    device_config.dataCallback = wrzAudioOutputCallback;
+    device_config.pUserData = out;
+
+    if(ma_device_init(&out->context, &device_config, &out->device) != MA_SUCCESS) {
+        printf("ERROR: AUDIO: Could not open a playback device!\n");
+        ma_context_uninit(&out->context);
+        return false;
+    }
+
+    out->period_frames = out->device.playback.internalPeriodSizeInFrames;
+    out->periods = out->device.playback.internalPeriods;
+
+    // the backend can keep every period queued up at once, so that is how far behind the speakers are in the worst case
+    out->latency = (double) out->period_frames * out->periods / out->device.playback.internalSampleRate;
+
+    printf("INFO: AUDIO: %s, %u periods of %u frames at %u Hz, %.1f ms buffered.\n", ma_get_backend_name(out->device.pContext->backend),
+        out->periods, out->period_frames, out->device.playback.internalSampleRate, out->latency * 1000.0);
+
+    // the buffers are only what we know about, a measured loopback latency also includes the driver and the DAC
+    if(calibrated_latency_ms >= 0.0f) {
+        out->latency = calibrated_latency_ms / 1000.0;
+        printf("INFO: AUDIO: Using calibrated output latency of %.1f ms.\n", calibrated_latency_ms);
+    }
+
+    ma_device_start(&out->device);
+    return true;
+}
+
+void wrzCloseAudioOutput(wrzAudioOutput * out) {
+#ifdef WRZ_JACK
+    if(out->jack) {
+        jack_deactivate(out->jack_client); // blocks until the process callback has returned for the last time
+        jack_client_close(out->jack_client);
+        return;
+    }
+#endif
+
+    ma_device_uninit(&out->device); // blocks until the callback has returned for the last time
+    ma_context_uninit(&out->context);
+}
+
+//------------------------------------------------------------------------------
+
+#ifdef WRZ_JACK
+// runs on the jack thread at the start of every cycle, before anything is rendered
+// the transport says where it is at the cycle's first frame, so the clicks are put right there instead of being pulled in gradually like a network follower
+void wrzFollowJackTransport(wrzAudioOutput * out) {
+    wrzClickEngine * e = out->engine;
+    jack_position_t pos;
+
+    bool rolling = jack_transport_query(out->jack_client, &pos) == JackTransportRolling && (pos.valid & JackPositionBBT) && pos.beats_per_minute >= 1.0;
+    bool started = rolling && !out->transport_was_rolling;
+    out->transport_was_rolling = rolling;
+    atomic_store(&out->transport_rolling, rolling);
+
+    if(!rolling) {
+        atomic_store(&e->bpm, 0.0); // no clicks while the transport is stopped, and wrzBeatPositionAt() says so too
+        return;
+    }
+
+    double bpm = fmin(pos.beats_per_minute, WRZ_MAX_BPM);
+    atomic_store(&out->transport_bpm, bpm);
+    atomic_store(&e->bpm, bpm);
+    atomic_store(&e->tempo_scale, 1.0);
+
+    // beats since bar 1 beat 1, in the transport's own beats (which are whatever its time signature says they are)
+    double beat = (pos.bar - 1) * (double) pos.beats_per_bar + (pos.beat - 1) + pos.tick / pos.ticks_per_beat;
+    double beat_frames = (60.0 * WRZ_SAMPLE_RATE) / bpm;
+    unsigned long long clock = atomic_load(&e->frame_clock);
+
+    // where the engine is at the same frame, counted from its last click
+    double error = beat - (e->beat_position + ((double) clock - e->last_grid_frame) / beat_frames);
+
+    if(started || fabs(error) >= 0.5) {
+        // just started, or the daw jumped somewhere else, so start over from the next beat. the engine is only ever written
+        // from this thread, so this is the same as what a tap does inside wrzRenderClicks()
+        double next = ceil(beat);
+        e->last_grid_frame = (double) clock + (next - beat) * beat_frames;
+        e->beat_position = next;
+        e->clicks_scheduled = 0;
+        e->sub_play_counter = 0;
+    } else if(fabs(error) * beat_frames >= fmax(0.5, 2.0 * beat_frames / pos.ticks_per_beat)) {
+        // after a tempo change, the engine changed tempo on its last click but the transport didn't. anything under a couple of ticks is just
+        // the transport rounding to whole ticks, both run off the same frame clock so they can't drift apart on their own
+        atomic_store(&e->phase_jump, error);
+    }
+}
+
+int wrzJackProcess(jack_nframes_t frames, void * arg) {
+    wrzAudioOutput * out = (wrzAudioOutput *) arg;
+
+    if(!out->thread_prepared) {
+        wrzPrepareAudioThread(out);
+        wrzCountAllocations(&wrz_counters.audio.allocations);
+        wrzTraceThread("audio");
+        out->thread_prepared = true;
+    }
+
+    double now = wrzNow();
+    long long allocations = atomic_load_explicit(&wrz_counters.audio.allocations, memory_order_relaxed); // only this thread writes it
+
+    if(out->follow_transport) wrzFollowJackTransport(out);
+
+    float * left = (float *) jack_port_get_buffer(out->jack_ports[0], frames);
+    float * right = (float *) jack_port_get_buffer(out->jack_ports[1], frames);
+
+    for(jack_nframes_t done = 0; done < frames; ) {
+        unsigned int chunk = (frames - done < WRZ_JACK_CHUNK) ? frames - done : WRZ_JACK_CHUNK;
+
+        out->engine->block_time = now + out->latency + (double) done / WRZ_SAMPLE_RATE;
+        wrzRenderClicks(out->engine, out->jack_scratch, chunk);
+
+        for(unsigned int i = 0; i < chunk; i++) {
+            left[done + i] = out->jack_scratch[i * 2];
+            right[done + i] = out->jack_scratch[i * 2 + 1];
+        }
+
+        done += chunk;
+    }
+
+    if(atomic_load_explicit(&wrz_counters.audio.allocations, memory_order_relaxed) != allocations) atomic_fetch_add(&wrz_counters.audio.allocating_callbacks, 1);
+
+    double end = wrzNow();
+    wrzTraceRecord("audio callback", 'X', now, end, "frames", frames);
+
+    double took = (end - now) * 1000.0;
+    wrzRecordStat(&wrz_counters.audio.callback_time, took);
+    wrzRecordStat(&wrz_counters.audio.deadline_margin, (frames * 1000.0) / WRZ_SAMPLE_RATE - took);
+    return 0;
+}
+
+int wrzJackXrun(void * arg) { // jack knows exactly when it runs dry, so there is no guessing from the gaps like in wrzAudioOutputCallback()
+    (void) arg;
+    atomic_fetch_add(&wrz_counters.audio.underruns, 1);
+    return 0;
+}
+#endif
+
+// plays `engine` as a jack client, connected to the first two physical outputs, with `follow_transport` taking the tempo and beat from the jack transport
+// returns false if this build has no jack, or if there is no jack server running, and then nothing has been opened
+bool wrzOpenJackOutput(wrzAudioOutput * out, wrzClickEngine * engine, bool follow_transport, float calibrated_latency_ms) {
+#ifdef WRZ_JACK
+    out->engine = engine;
+    out->jack = true;
+    out->follow_transport = follow_transport;
+    out->transport_was_rolling = false;
+    out->last_callback_time = 0.0;
+    out->thread_prepared = false;
+    atomic_store(&out->realtime_status, 0);
+    atomic_store(&out->transport_rolling, 0);
+
+    jack_status_t status;
+    out->jack_client = jack_client_open("WRZ Metronome", JackNoStartServer, &status);
+    if(out->jack_client == NULL) {
+        printf("WARNING: JACK: Could not connect to a jack server, is one running?\n");
+        return false;
+    }
+
+    if(jack_get_sample_rate(out->jack_client) != WRZ_SAMPLE_RATE) {
+        printf("WARNING: JACK: The server runs at %u Hz, but the click engine only runs at %d Hz.\n", jack_get_sample_rate(out->jack_client), WRZ_SAMPLE_RATE);
+        jack_client_close(out->jack_client);
+        return false;
+    }
+
+    out->jack_ports[0] = jack_port_register(out->jack_client, "left", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+    out->jack_ports[1] = jack_port_register(out->jack_client, "right", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+    if(out->jack_ports[0] == NULL || out->jack_ports[1] == NULL) {
+        printf("WARNING: JACK: Could not register the output ports.\n");
+        jack_client_close(out->jack_client);
+        return false;
+    }
+
+    // jackd decides whether its clients run real-time, wrzPrepareAudioThread() only reports what it decided
+    out->realtime = jack_is_realtime(out->jack_client);
+    out->period_frames = jack_get_buffer_size(out->jack_client);
+    out->periods = 2;
+    out->latency = (double) out->period_frames * out->periods / WRZ_SAMPLE_RATE; // unless the hardware says otherwise below
+
+    const char ** physical = jack_get_ports(out->jack_client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+
+    // the playback latency of the hardware ports is how long after a cycle its first frame is heard
+    if(physical != NULL && physical[0] != NULL) {
+        jack_latency_range_t range;
+        jack_port_get_latency_range(jack_port_by_name(out->jack_client, physical[0]), JackPlaybackLatency, &range);
+        if(range.max > 0) out->latency = (double) range.max / WRZ_SAMPLE_RATE;
+    }
+
+    if(calibrated_latency_ms >= 0.0f) out->latency = calibrated_latency_ms / 1000.0;
+
+    jack_set_process_callback(out->jack_client, wrzJackProcess, out);
+    jack_set_xrun_callback(out->jack_client, wrzJackXrun, out);
+
+    if(jack_activate(out->jack_client) != 0) {
+        printf("WARNING: JACK: Could not activate the client.\n");
+        if(physical != NULL) jack_free(physical);
+        jack_client_close(out->jack_client);
+        return false;
+    }
+
+    // after activating, jack won't connect ports that aren't running yet
+    for(int i = 0; i < 2 && physical != NULL && physical[i] != NULL; i++) jack_connect(out->jack_client, jack_port_name(out->jack_ports[i]), physical[i]);
+    if(physical != NULL) jack_free(physical);
+
+    printf("INFO: JACK: Running as a jack client, %u frames per cycle, %.1f ms to the speakers%s.\n", out->period_frames, out->latency * 1000.0,
+        follow_transport ? ", following the transport" : "");
+    return true;
+#else
+    (void) out; (void) engine; (void) follow_transport; (void) calibrated_latency_ms;
+    printf("WARNING: JACK: This build has no jack support, rebuild with `make linux JACK=1`.\n");
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+    wrzClickEngine * engine;
+    float * capture; // mono, everything the input heard, indexed by the same frame clock as the engine
+    long long capture_frames;
+    _Atomic long long captured; // how far the device has gotten, written by the audio thread
+} wrzCalibration;
+
+void wrzCalibrationCallback(ma_device * device, void * output, const void * input, ma_uint32 frames) {
+    wrzCalibration * cal = (wrzCalibration *) device->pUserData;
+
+    long long at = cal->captured;
+    wrzRenderClicks(cal->engine, (float *) output, frames);
+
+    for(ma_uint32 i = 0; i < frames && at + i < cal->capture_frames; i++) cal->capture[at + i] = ((const float *) input)[i];
+    cal->captured = at + frames;
+}
+
+// plays clicks out of the default output and listens for them on the default input, which should be looped back into it with a cable
+// returns the output latency in milliseconds, or a negative number if the clicks never came back
+float wrzCalibrateLatency(wrzClickEngine * engine, const char * backend_name, int period_frames, int periods) {
+    wrzCalibration cal = { 0 };
+    cal.engine = engine;
+    cal.capture_frames = (long long) (WRZ_CALIBRATION_CLICKS + 1) * WRZ_SAMPLE_RATE / 2; // one click every half second at 120 bpm
+    cal.capture = calloc(cal.capture_frames, sizeof(float));
+
+    atomic_store(&engine->bpm, 120.0);
+    atomic_store(&engine->subdivision, 1);
+
+    ma_device_config device_config = ma_device_config_init(ma_device_type_duplex);
+    device_config.playback.format = ma_format_f32;
+    device_config.playback.channels = 2;
+    device_config.capture.format = ma_format_f32;
+    device_config.capture.channels = 1;
+    device_config.sampleRate = WRZ_SAMPLE_RATE;
+    device_config.periodSizeInFrames = (period_frames > 0) ? period_frames : 0;
+    device_config.periods = (periods > 0) ? periods : 0;
+    device_config.performanceProfile = ma_performance_profile_low_latency;
+    device_config.dataCallback = wrzCalibrationCallback;
+    device_config.pUserData = &cal;
+
+    // measure through the same backend that will be played through, they don't all have the same latency
+    ma_backend backend;
+    bool chosen = wrzFindAudioBackend(backend_name, &backend);
+
+    ma_device device;
+    if(ma_device_init_ex(chosen ? &backend : NULL, chosen ? 1 : 0, NULL, &device_config, &device) != MA_SUCCESS) {
+        printf("ERROR: CALIBRATE: Could not open a duplex device!\n");
+        free(cal.capture);
+        return -1.0f;
+    }
+
+    printf("INFO: CALIBRATE: Playing %d clicks, make sure the output is looped back into the input...\n", WRZ_CALIBRATION_CLICKS);
+
+    ma_device_start(&device);
+    while(cal.captured < cal.capture_frames) ma_sleep(50); // only read once the device is done with it
+    unsigned int capture_buffering = device.capture.internalPeriodSizeInFrames; // input sits in (at least) one period before we see it
+    ma_device_uninit(&device);
+
+    //------------------------------------------------------------------------------
+
+    // the noise floor decides how loud an echo has to be to count
+    float floor = 0.0f;
+    for(long long i = 0; i < cal.capture_frames; i++) floor += fabsf(cal.capture[i]);
+    floor = 4.0f * floor / cal.capture_frames;
+
+    int delays[WRZ_CALIBRATION_CLICKS];
+    int found = 0;
+
+    long long count = atomic_load(&engine->click_count);
+    for(long long c = 0; c < count && c < WRZ_CLICK_HISTORY && found < WRZ_CALIBRATION_CLICKS; c++) {
+        long long onset = (long long) atomic_load(&engine->click_history[c]);
+        long long end = onset + (long long) (WRZ_CALIBRATION_WINDOW * WRZ_SAMPLE_RATE);
+        if(end > cal.capture_frames) break;
+
+        float peak = 0.0f;
+        for(long long i = onset; i < end; i++) if(fabsf(cal.capture[i]) > peak) peak = fabsf(cal.capture[i]);
+        if(peak <= floor) continue; // nothing came back for this one
+
+        // the echo's onset is found the same way the sample's onset was, relative to its own peak
+        long long i = onset;
+        while(fabsf(cal.capture[i]) < peak * WRZ_ONSET_THRESHOLD) i++;
+
+        // insertion sort, there are only a handful
+        int delay = (int) (i - onset), j = found++;
+        while(j > 0 && delays[j - 1] > delay) { delays[j] = delays[j - 1]; j--; }
+        delays[j] = delay;
+    }
+
+    free(cal.capture);
+
+    if(found < WRZ_CALIBRATION_CLICKS / 2) {
+        printf("ERROR: CALIBRATE: Only heard %d of %d clicks, is the loopback connected and loud enough?\n", found, WRZ_CALIBRATION_CLICKS);
+        return -1.0f;
+    }
+
+    // the median round trip, minus the part of it spent waiting in the input buffer
+    int round_trip = delays[found / 2];
+    float latency_ms = ((round_trip - (int) capture_buffering) * 1000.0f) / WRZ_SAMPLE_RATE;
+    if(latency_ms < 0.0f) latency_ms = 0.0f;
+
+    printf("INFO: CALIBRATE: Round trip %.1f ms over %d clicks, output latency %.1f ms.\n", (round_trip * 1000.0f) / WRZ_SAMPLE_RATE, found, latency_ms);
+    return latency_ms;
+}
+
+//------------------------------------------------------------------------------
+
+// in-place radix-2 fft, `n` has to be a power of two
+void wrzFFT(float * re, float * im, int n) {
+    for(int i = 1, j = 0; i < n; i++) { // bit-reversed order first
+        int bit = n >> 1;
+        for(; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+
+        if(i < j) {
+            float swap = re[i]; re[i] = re[j]; re[j] = swap;
+            swap = im[i]; im[i] = im[j]; im[j] = swap;
+        }
+    }
+
+    for(int length = 2; length <= n; length <<= 1) {
+        double step_re = cos(-2.0 * PI / length), step_im = sin(-2.0 * PI / length);
+
+        for(int i = 0; i < n; i += length) {
+            double w_re = 1.0, w_im = 0.0;
+
+            for(int j = 0; j < length / 2; j++) {
+                int a = i + j, b = i + j + length / 2;
+                float v_re = (float) (re[b] * w_re - im[b] * w_im);
+                float v_im = (float) (re[b] * w_im + im[b] * w_re);
+
+                re[b] = re[a] - v_re; im[b] = im[a] - v_im;
+                re[a] += v_re; im[a] += v_im;
+
+                double next_re = w_re * step_re - w_im * step_im;
+                w_im = w_re * step_im + w_im * step_re;
+                w_re = next_re;
+            }
+        }
+    }
+}
+
+void wrzTrackerCaptureCallback(ma_device * device, void * output, const void * input, ma_uint32 frames) {
+    wrzBeatTracker * t = (wrzBeatTracker *) device->pUserData;
+    (void) output; // capture only
+    double now = wrzNow();
+
+    long long written = atomic_load_explicit(&t->written, memory_order_relaxed);
+    for(ma_uint32 i = 0; i < frames; i++) t->ring[(written + i) & (WRZ_TRACK_RING - 1)] = ((const float *) input)[i];
+    written += frames;
+    atomic_store_explicit(&t->written, written, memory_order_release);
+
+    // the last frame of the block was heard just now, give or take, so average over many blocks
+    double epoch = now - (double) written / WRZ_SAMPLE_RATE;
+    double previous = atomic_load_explicit(&t->epoch, memory_order_relaxed);
+    atomic_store_explicit(&t->epoch, (previous == 0.0) ? epoch : previous + 0.01 * (epoch - previous), memory_order_relaxed);
+}
+
+// spectral flux: how much louder every frequency got since the last hop, which is large where a drum is hit and small while it rings
+float wrzOnsetStrength(wrzBeatTracker * t) {
+    for(int i = 0; i < WRZ_TRACK_FFT; i++) {
+        t->re[i] = t->frame[i] * t->window[i];
+        t->im[i] = 0.0f;
+    }
+
+    wrzFFT(t->re, t->im, WRZ_TRACK_FFT);
+
+    float flux = 0.0f;
+    for(int k = 0; k <= WRZ_TRACK_FFT / 2; k++) {
+        float magnitude = log1pf(100.0f * sqrtf(t->re[k] * t->re[k] + t->im[k] * t->im[k])); // log, so quiet hits count as well as loud ones
+        if(magnitude > t->previous[k]) flux += magnitude - t->previous[k];
+        t->previous[k] = magnitude;
+    }
+
+    return flux;
+}
+
+// autocorrelation of the onset envelope finds the tempo, then the beat is put where the envelope lines up best with a comb at that tempo
+void wrzEstimateBeat(wrzBeatTracker * t) {
+    int n = (t->hops < WRZ_TRACK_HISTORY) ? (int) t->hops : WRZ_TRACK_HISTORY;
+    double rate = (double) WRZ_SAMPLE_RATE / WRZ_TRACK_HOP; // envelope values per second
+
+    float mean = 0.0f;
+    for(int i = 0; i < n; i++) {
+        t->series[i] = t->envelope[(t->hops - n + i) % WRZ_TRACK_HISTORY];
+        mean += t->series[i];
+    }
+    mean /= n;
+    for(int i = 0; i < n; i++) t->series[i] -= mean;
+
+    int min_lag = (int) floor(60.0 * rate / WRZ_TRACK_MAX_BPM), max_lag = (int) ceil(60.0 * rate / WRZ_TRACK_MIN_BPM);
+    if(max_lag * 2 >= n) return; // not enough heard yet to see two beats' worth at the slowest tempo
+
+    double energy = 0.0;
+    for(int i = 0; i < n; i++) energy += t->series[i] * t->series[i];
+    if(energy <= 0.0) return; // silence
+
+    int best_lag = 0;
+    double best_score = 0.0, correlation[3] = { 0.0 }; // around the best lag, for interpolating
+    double previous_correlation = 0.0;
+
+    for(int lag = min_lag - 1; lag <= max_lag + 1; lag++) {
+        double sum = 0.0;
+        for(int i = lag; i < n; i++) sum += t->series[i] * t->series[i - lag];
+        sum /= (n - lag);
+
+        // lean towards tempos around 120, so a beat isn't taken for half or double of what it is
+        double octaves = log2((60.0 * rate / lag) / 120.0);
+        double score = sum * exp(-0.5 * octaves * octaves);
+
+        if(lag >= min_lag && lag <= max_lag && score > best_score) {
+            best_score = score;
+            best_lag = lag;
+            correlation[0] = previous_correlation;
+            correlation[1] = sum;
+        }
+        if(lag == best_lag + 1) correlation[2] = sum;
+        previous_correlation = sum;
+    }
+
+    if(best_lag == 0 || correlation[1] < 0.05 * energy / n) return; // nothing periodic enough to follow
+
+    // a parabola through the peak puts it between two lags
+    double curve = correlation[0] - 2.0 * correlation[1] + correlation[2];
+    double period = best_lag + ((curve < 0.0) ? 0.5 * (correlation[0] - correlation[2]) / curve : 0.0); // in hops
+
+    int best_offset = 0;
+    double best_comb = -1e30;
+    for(int offset = 0; offset < (int) period; offset++) {
+        double comb = 0.0;
+        for(int k = 0; k < 8; k++) {
+            int i = n - 1 - offset - (int) lround(k * period);
+            if(i < 0) break;
+            comb += t->series[i];
+        }
+        if(comb > best_comb) { best_comb = comb; best_offset = offset; }
+    }
+
+    double bpm = 60.0 * rate / period;
+    double current = atomic_load(&t->bpm);
+
+    if(current > 0.0 && fabs(bpm / current - 1.0) < 0.04) bpm = current + WRZ_TRACK_SMOOTHING * (bpm - current);
+    else if(fabs(bpm / t->candidate_bpm - 1.0) >= 0.04) {
+        t->candidate_bpm = bpm;
+        return;
+    }
+    t->candidate_bpm = bpm;
+
+    // hop h compares the spectrum of the frames up to (h + 1) * WRZ_TRACK_HOP, an onset shows up by the middle of that window
+    long long hop = t->hops - 1 - best_offset;
+    double epoch = (t->file != NULL) ? t->epoch : atomic_load(&t->epoch);
+    double beat_time = epoch + ((double) (hop + 1) * WRZ_TRACK_HOP - WRZ_TRACK_FFT / 2) / WRZ_SAMPLE_RATE;
+
+    atomic_store(&t->bpm, bpm);
+    atomic_store(&t->beat_time, beat_time);
+    atomic_fetch_add(&t->estimates, 1);
+}
+
+#ifndef _WIN32
+void * wrzBeatTrackerThread(void * data) {
+    wrzBeatTracker * t = (wrzBeatTracker *) data;
+    wrzTraceThread("beat tracker");
+
+    while(atomic_load(&t->running)) {
+        // wait for the next hop's worth of input
+        if(t->file != NULL) {
+            if(t->read + WRZ_TRACK_HOP > t->file_frames) break; // the file is over, the tempo stays where it got to
+
+            double due = t->epoch + (double) (t->read + WRZ_TRACK_HOP) / WRZ_SAMPLE_RATE;
+            double wait = due - wrzNow();
+            if(wait > 0.0) {
+                struct timespec nap = { (time_t) wait, (long) ((wait - floor(wait)) * 1e9) };
+                nanosleep(&nap, NULL);
+            }
+        } else {
+            long long written = atomic_load_explicit(&t->written, memory_order_acquire);
+            if(written - t->read < WRZ_TRACK_HOP) {
+                struct timespec nap = { 0, 2000000 };
+                nanosleep(&nap, NULL);
+                continue;
+            }
+            if(written - t->read > WRZ_TRACK_RING - WRZ_TRACK_HOP) t->read = written - WRZ_TRACK_HOP; // fell behind, skip what got overwritten
+        }
+
+        memmove(t->frame, t->frame + WRZ_TRACK_HOP, (WRZ_TRACK_FFT - WRZ_TRACK_HOP) * sizeof(float));
+        for(int i = 0; i < WRZ_TRACK_HOP; i++) {
+            long long at = t->read + i;
+            t->frame[WRZ_TRACK_FFT - WRZ_TRACK_HOP + i] = (t->file != NULL) ? t->file[at] : t->ring[at & (WRZ_TRACK_RING - 1)];
+        }
+        t->read += WRZ_TRACK_HOP;
+
+        t->envelope[t->hops % WRZ_TRACK_HISTORY] = wrzOnsetStrength(t);
+        t->hops++;
+
+        if(t->hops % WRZ_TRACK_EVERY == 0) {
+            double start = wrzTraceBegin();
+            wrzEstimateBeat(t);
+            wrzTraceEnd("estimate beat", start, "hops", t->hops);
+        }
+    }
+
+    return NULL;
+}
+#endif
+
+// follows the beat of whatever the default input hears, or of the wav/ogg/flac/mp3 at `path` (played back silently, in real time) if it isn't NULL
+bool wrzOpenBeatTracker(wrzBeatTracker * t, const char * path) {
+    memset(t, 0, sizeof(wrzBeatTracker));
+
+#ifndef _WIN32
+    for(int i = 0; i < WRZ_TRACK_FFT; i++) t->window[i] = 0.5f - 0.5f * cosf(2.0f * PI * i / WRZ_TRACK_FFT); // hann
+
+    if(path != NULL) {
+        Wave wave = LoadWave(path);
+        if(wave.data == NULL || wave.frameCount == 0) {
+            printf("WARNING: TRACK: Could not decode \"%s\", carrying on without beat tracking.\n", path);
+            UnloadWave(wave);
+            return false;
+        }
+
+        WaveFormat(&wave, WRZ_SAMPLE_RATE, 32, 1);
+        t->file = LoadWaveSamples(wave);
+        t->file_frames = wave.frameCount;
+        UnloadWave(wave);
+
+        t->epoch = wrzNow();
+    } else {
+        ma_device_config device_config = ma_device_config_init(ma_device_type_capture);
+        device_config.capture.format = ma_format_f32;
+        device_config.capture.channels = 1;
+        device_config.sampleRate = WRZ_SAMPLE_RATE;
+        device_config.performanceProfile = ma_performance_profile_low_latency;
+        device_config.dataCallback = wrzTrackerCaptureCallback;
+        device_config.pUserData = t;
+
+        if(ma_device_init(NULL, &device_config, &t->device) != MA_SUCCESS) {
+            printf("WARNING: TRACK: Could not open a capture device, carrying on without beat tracking.\n");
+            return false;
+        }
+
+        t->capturing = true;
+        ma_device_start(&t->device);
+    }
+
+    atomic_store(&t->running, 1);
+    pthread_create(&t->thread, NULL, wrzBeatTrackerThread, t);
+
+    printf("INFO: TRACK: Following the beat of %s%s%s.\n", (path != NULL) ? "\"" : "the default input", (path != NULL) ? path : "", (path != NULL) ? "\"" : "");
+    return true;
+#else
+    printf("WARNING: TRACK: Beat tracking is not supported on this platform yet.\n");
+    return false;
+#endif
+}
+
+void wrzCloseBeatTracker(wrzBeatTracker * t) {
+#ifndef _WIN32
+    if(!atomic_load(&t->running)) return;
+
+    atomic_store(&t->running, 0);
+    pthread_join(t->thread, NULL);
+
+    if(t->capturing) ma_device_uninit(&t->device);
+    if(t->file != NULL) UnloadWaveSamples(t->file);
+#endif
+}
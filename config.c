@@ -0,0 +1,205 @@
+// the config file and the command line
+#include "metronome.h"
+
+wrzProgramConfig wrzLoadProgramConfig(const char * filepath) {
+    //------------------------------------------------------------------------------
+
+    wrzProgramConfig output = { 0 };
+    output.output_latency_ms = -1.0f; // defaults for the optional options, which older config files won't have
+
+    if(!FileExists(filepath)) { // if the file does not exist, crash
+        // TODO: make this create and load a default configuration file
+        printf("WARNING: CONFIG: Config file \"%s\" not found! Creating \"./metronome.config\" with default settings.\n", filepath);
+
+        FILE * default_config = fopen("./metronome.config", "w"); // create the default config file
+
+        fprintf(default_config, "PRIMARY = 1\nSECONDARY = 2\n"); // write default beat configuration
+        fprintf(default_config, "BEATSDIR = \"./resources/beats/\"\nSTYLEPATH = \"\""); // intentionally empty stylepath by default
+
+        fclose(default_config);
+    }
+
+    //------------------------------------------------------------------------------
+
+    // if filepath does not exist, load the default that we just created
+    FILE * config_file = fopen((FileExists(filepath)) ? filepath : "./metronome.config", "r");
+
+    int imported_beat_idx = -1; // holder variables that file data will be loaded into before processing
+    int imported_sub_beat_idx = -1;
+
+    char imported_beats_dir_buffer[255]; // holder buffers as above
+    char imported_style_path_buffer[255];
+
+    memset(imported_beats_dir_buffer, '\0', 255); // pre-set memory to avoid funny business 
+    memset(imported_style_path_buffer, '\0', 255);
+
+    char config_file_line[255]; // line buffer for when the file is read line-by-line
+    memset(config_file_line, '\0', 255);
+
+    // typically, fgets() is used in a while loop ie. while(fgets(...)); this is just an unwrapped version of such a loop
+    fgets(config_file_line, 255, config_file);
+    sscanf(config_file_line, "PRIMARY = %d", &imported_beat_idx); // load config file data into the holder variable
+    printf("INFO: CONFIG: Loaded config option, primary beat sound set to #%d.\n", imported_beat_idx);
+
+    memset(config_file_line, '\0', 255); // clear the line buffer to avoid funny business
+
+    // every fgets() call advances through the file by one line
+    fgets(config_file_line, 255, config_file);
+    sscanf(config_file_line, "SECONDARY = %d", &imported_sub_beat_idx); // load config data as above
+    printf("INFO: CONFIG: Loaded config option, secondary beat sound set to #%d.\n", imported_sub_beat_idx);
+
+    memset(config_file_line, '\0', 255);
+
+    fgets(config_file_line, 255, config_file);
+    // everything up to the closing quote, so paths with spaces in them work too; a line that doesn't match leaves the buffer empty
+    if(sscanf(config_file_line, "BEATSDIR = \"%254[^\"]\"", imported_beats_dir_buffer) != 1) imported_beats_dir_buffer[0] = '\0';
+
+    if(!DirectoryExists(imported_beats_dir_buffer)) { // check the imported data for cogency
+        printf("WARNING: CONFIG: Provided beats directory \"%s\" does not exist! Attemping to load default directory...\n", imported_beats_dir_buffer);
+
+        if(!DirectoryExists("./resources/beats/")) { // if the default directory is gone
+            printf("ERROR: CONFIG: No beats directory found!\n"); // that means neither the specified nor default directory exists
+            exit(4); // can't do much with no beats, so we crash
+        }
+        
+        strcpy(imported_beats_dir_buffer, "./resources/beats"); // otherwise, use the default beat directory (not guaranteed to have anything inside it, though)
+    }
+    
+    printf("INFO: CONFIG: Loaded config option, beats directory is \"%s\".\n", imported_beats_dir_buffer);
+
+    memset(config_file_line, '\0', 255);
+
+    fgets(config_file_line, 255, config_file);
+    if(sscanf(config_file_line, "STYLEPATH = \"%254[^\"]\"", imported_style_path_buffer) != 1) imported_style_path_buffer[0] = '\0'; // as above
+
+    // if it does not exist, we will set it to NULL below
+    if(FileExists(imported_style_path_buffer)) printf("INFO: CONFIG: Loaded config option, style path is \"%s\".\n", imported_style_path_buffer);
+
+    char backend_name[32];
+
+    // everything after the first four lines is optional, and can come in any order
+    while(fgets(config_file_line, 255, config_file) != NULL) {
+        if(sscanf(config_file_line, "AUDIOBUFFER = %d", &output.audio_buffer_frames) == 1) {
+            printf("INFO: CONFIG: Loaded config option, audio buffer is %d frames.\n", output.audio_buffer_frames);
+        } else if(sscanf(config_file_line, "PERIODS = %d", &output.audio_periods) == 1) {
+            printf("INFO: CONFIG: Loaded config option, audio buffer is split into %d periods.\n", output.audio_periods);
+        } else if(sscanf(config_file_line, "REALTIME = %d", &output.realtime) == 1) {
+            printf("INFO: CONFIG: Loaded config option, real-time audio is %s.\n", output.realtime ? "on" : "off");
+        } else if(sscanf(config_file_line, "LATENCY = %f", &output.output_latency_ms) == 1) {
+            printf("INFO: CONFIG: Loaded config option, calibrated output latency is %.1f ms.\n", output.output_latency_ms);
+        } else if(sscanf(config_file_line, "AUDIOBACKEND = %31s", backend_name) == 1) {
+            free(output.audio_backend);
+            output.audio_backend = (strcmp(backend_name, "auto") != 0) ? strdup(backend_name) : NULL;
+            printf("INFO: CONFIG: Loaded config option, audio backend is %s.\n", backend_name);
+        }
+
+        memset(config_file_line, '\0', 255);
+    }
+
+    fclose(config_file);
+
+    //------------------------------------------------------------------------------
+
+    output.primary_beat_no = imported_beat_idx; // 1-idx
+    output.secondary_beat_no = imported_sub_beat_idx; // 1-idx
+
+    output.beats_directory = malloc(strlen(imported_beats_dir_buffer) + 1); // load directory that we now know exists into config options
+    strcpy(output.beats_directory, imported_beats_dir_buffer); // note that this directory could be empty, wrzLoadBeatSounds() performs that check
+
+    // note that the reason there is no default style path/folder like there is for the beats is that raygui.h packages the default style in the code itself
+    if(FileExists(imported_style_path_buffer)) { // if we have a style path
+        output.style_filepath = malloc(strlen(imported_style_path_buffer) + 1);
+        strcpy(output.style_filepath, imported_style_path_buffer);
+    } else { // use the raygui default one, which comes in raygui.h
+        output.style_filepath = NULL;
+        printf("WARNING: CONFIG: Style \"%s\" not found! Loading raygui default style.\n", imported_style_path_buffer);
+    }
+
+    // we did not malloc() the input buffers, so no need to free them
+    return output;
+}
+
+// note that this deletes previous config, we will rewrite it
+void wrzSaveProgramConfig(wrzProgramConfig * c) {
+    /* file format is such that
+    PRIMARY = INT
+    SECONDARY = INT
+    BEATSDIR = "..."
+    STYLEPATH = "..."
+    AUDIOBUFFER = INT    (optional)
+    PERIODS = INT        (optional)
+    REALTIME = 0 OR 1    (optional)
+    LATENCY = FLOAT      (optional)
+    AUDIOBACKEND = NAME  (optional)
+    */
+    
+    // TODO: investigate whether this works on Linux ie. whether this works over both \r\n and \n systems
+
+    FILE * config_file = fopen("./metronome.config", "w+");
+
+    // write to the newly created config file
+    fprintf(config_file, "PRIMARY = %d\nSECONDARY = %d\n", c->primary_beat_no, c->secondary_beat_no);
+
+    printf("INFO: CONFIG: Updated config file, primary = %d and secondary = %d.\n", c->primary_beat_no, c->secondary_beat_no);
+
+    fprintf(config_file, "BEATSDIR = \"%s\"\nSTYLEPATH = \"%s\"\n", c->beats_directory, (c->style_filepath != NULL) ? c->style_filepath : "");
+
+    fprintf(config_file, "AUDIOBUFFER = %d\nPERIODS = %d\nREALTIME = %d\nLATENCY = %.2f\n", c->audio_buffer_frames, c->audio_periods, c->realtime, c->output_latency_ms);
+    fprintf(config_file, "AUDIOBACKEND = %s", (c->audio_backend != NULL) ? c->audio_backend : "auto");
+
+    fclose(config_file);
+}
+
+void wrzDestroyProgramConfig(wrzProgramConfig * c) {
+    free(c->beats_directory);
+    free(c->style_filepath);
+    free(c->audio_backend);
+}
+
+//------------------------------------------------------------------------------
+
+wrzCommandLine wrzParseCommandLine(int argc, char ** argv) {
+    wrzCommandLine output = { 0 };
+    output.period_frames = -1;
+    output.periods = -1;
+
+    for(int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc); // for the options that take a number after them
+
+        if(strcmp(argv[i], "--calibrate") == 0) output.calibrate = true;
+        else if(strcmp(argv[i], "--period-size") == 0 && has_value) output.period_frames = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--periods") == 0 && has_value) output.periods = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--audio-backend") == 0 && has_value) output.audio_backend = argv[++i];
+        else if(strcmp(argv[i], "--realtime") == 0) output.realtime = true;
+        else if(strcmp(argv[i], "--stats") == 0) output.stats = true;
+        else if(strcmp(argv[i], "--stats-json") == 0 && has_value) output.stats_path = argv[++i];
+        else if(strcmp(argv[i], "--trace") == 0 && has_value) output.trace_path = argv[++i];
+        else if(strcmp(argv[i], "--midi") == 0) output.midi = true;
+        else if(strcmp(argv[i], "--jack") == 0) output.jack = true;
+        else if(strcmp(argv[i], "--jack-transport") == 0) output.jack = output.jack_transport = true;
+        else if(strcmp(argv[i], "--export-midi") == 0 && has_value) output.midi_export_path = argv[++i];
+        else if(strcmp(argv[i], "--sync-lead") == 0 && has_value) output.sync_lead = argv[++i];
+        else if(strcmp(argv[i], "--sync-follow") == 0 && has_value) output.sync_follow = argv[++i];
+        else if(strcmp(argv[i], "--follow-input") == 0) output.follow_input = true;
+        else if(strcmp(argv[i], "--follow-file") == 0 && has_value) output.follow_file = argv[++i];
+        else if(strcmp(argv[i], "--tap-device") == 0 && has_value) output.tap_device = argv[++i];
+        else if(strcmp(argv[i], "--server") == 0 && has_value) output.server_path = argv[++i];
+        else if(strcmp(argv[i], "--workers") == 0 && has_value) output.workers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--alloc-audit") == 0) output.alloc_audit = true;
+        else if(strcmp(argv[i], "--record") == 0 && has_value) output.record_path = argv[++i];
+        else if(strcmp(argv[i], "--replay") == 0 && has_value) output.replay_path = argv[++i];
+        else if(strcmp(argv[i], "--duration") == 0 && has_value) output.duration = atof(argv[++i]);
+        else if(strcmp(argv[i], "--stress") == 0) output.stress = true;
+        else if(strcmp(argv[i], "--stream") == 0 && has_value) output.stream_path = argv[++i];
+        else if(strcmp(argv[i], "--bpm") == 0 && has_value) output.bpm = atof(argv[++i]);
+        else if(strcmp(argv[i], "--subdivision") == 0 && has_value) output.subdivision = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--rate") == 0 && has_value) output.rate = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--format") == 0 && has_value) output.format = argv[++i];
+        else if(strcmp(argv[i], "--fast") == 0) output.fast = true;
+        else if(strcmp(argv[i], "--render") == 0 && has_value) output.render_path = argv[++i];
+        else if(strcmp(argv[i], "--batch") == 0 && has_value) output.batch_path = argv[++i];
+        else printf("WARNING: Ignoring unknown command line option \"%s\".\n", argv[i]);
+    }
+
+    return output;
+}
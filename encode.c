@@ -0,0 +1,309 @@
+// the wav and flac writers the headless modes save click tracks with
+#include "metronome.h"
+
+// 16-bit stereo at WRZ_SAMPLE_RATE, `frames` is negative if the length isn't known yet, then the sizes are left at their
+// maximum so that whatever reads a stream just keeps going, see wrzFinishWav()
+void wrzWriteWavHeader(FILE * f, long long frames) {
+    unsigned int data_bytes = (frames < 0) ? 0xFFFFFFFFu - 36 : (unsigned int) (frames * 4);
+    unsigned char header[44];
+    unsigned char * cursor = header;
+
+    memcpy(cursor, "RIFF", 4); cursor += 4;
+    wrzWriteLittleEndian(&cursor, 36 + data_bytes, 4);
+    memcpy(cursor, "WAVEfmt ", 8); cursor += 8;
+    wrzWriteLittleEndian(&cursor, 16, 4);
+    wrzWriteLittleEndian(&cursor, 1, 2); // integer pcm
+    wrzWriteLittleEndian(&cursor, 2, 2);
+    wrzWriteLittleEndian(&cursor, WRZ_SAMPLE_RATE, 4);
+    wrzWriteLittleEndian(&cursor, WRZ_SAMPLE_RATE * 4, 4); // bytes per second
+    wrzWriteLittleEndian(&cursor, 4, 2); // bytes per frame
+    wrzWriteLittleEndian(&cursor, 16, 2);
+    memcpy(cursor, "data", 4); cursor += 4;
+    wrzWriteLittleEndian(&cursor, data_bytes, 4);
+
+    fwrite(header, 1, sizeof(header), f);
+}
+
+// goes back and fills in the real length, if `f` is a file and not a pipe
+void wrzFinishWav(FILE * f, long long frames) {
+    if(fseek(f, 0, SEEK_SET) == 0) wrzWriteWavHeader(f, frames);
+}
+
+// `block` is stereo interleaved, like wrzRenderClicks() writes it
+void wrzWritePcm16(FILE * f, const float * block, unsigned int frames) {
+    unsigned char pcm[WRZ_SERVER_BLOCK * 4];
+
+    for(unsigned int done = 0; done < frames; done += WRZ_SERVER_BLOCK) {
+        unsigned int count = (frames - done < WRZ_SERVER_BLOCK) ? frames - done : WRZ_SERVER_BLOCK;
+        unsigned char * cursor = pcm;
+
+        for(unsigned int i = 0; i < count * 2; i++) wrzWriteLittleEndian(&cursor, (unsigned short) (short) lrintf(block[done * 2 + i] * 32767.0f), 2);
+        fwrite(pcm, 1, count * 4, f);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void wrzPutBits(wrzBitWriter * w, unsigned int value, int count) { // count <= 32
+    if(count == 0) return;
+    w->bits = (w->bits << count) | (value & (0xFFFFFFFFu >> (32 - count)));
+    w->bit_count += count;
+
+    while(w->bit_count >= 8) {
+        w->bit_count -= 8;
+        w->data[w->bytes++] = (unsigned char) (w->bits >> w->bit_count);
+    }
+}
+
+void wrzPadBits(wrzBitWriter * w) {
+    if(w->bit_count > 0) wrzPutBits(w, 0, 8 - w->bit_count);
+}
+
+void wrzPutRice(wrzBitWriter * w, int value, int parameter) {
+    unsigned int folded = ((unsigned int) value << 1) ^ (unsigned int) (value >> 31); // 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+    unsigned int quotient = folded >> parameter;
+
+    for(; quotient >= 32; quotient -= 32) wrzPutBits(w, 0, 32);
+    wrzPutBits(w, 1, quotient + 1);
+    wrzPutBits(w, folded, parameter);
+}
+
+unsigned char wrzCrc8(const unsigned char * data, size_t length) { // polynomial x^8 + x^2 + x + 1
+    unsigned char crc = 0;
+    for(size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for(int b = 0; b < 8; b++) crc = (crc & 0x80) ? (unsigned char) ((crc << 1) ^ 0x07) : (unsigned char) (crc << 1);
+    }
+    return crc;
+}
+
+unsigned short wrzCrc16(const unsigned char * data, size_t length) { // polynomial x^16 + x^15 + x^2 + 1
+    unsigned short crc = 0;
+    for(size_t i = 0; i < length; i++) {
+        crc ^= (unsigned short) (data[i] << 8);
+        for(int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (unsigned short) ((crc << 1) ^ 0x8005) : (unsigned short) (crc << 1);
+    }
+    return crc;
+}
+
+// what is left of `samples` after predicting each one from the `order` before it with flac's fixed polynomials
+void wrzFixedResidual(const int * samples, int count, int order, int * residual) {
+    for(int i = order; i < count; i++) {
+        const int * x = &samples[i];
+        switch(order) {
+            case 0: residual[i] = x[0]; break;
+            case 1: residual[i] = x[0] - x[-1]; break;
+            case 2: residual[i] = x[0] - 2 * x[-1] + x[-2]; break;
+            case 3: residual[i] = x[0] - 3 * x[-1] + 3 * x[-2] - x[-3]; break;
+            default: residual[i] = x[0] - 4 * x[-1] + 6 * x[-2] - 4 * x[-3] + x[-4]; break;
+        }
+    }
+}
+
+// roughly how many bits the residual takes with the best partitioning, which goes in `partition_order` and `parameters`
+long long wrzRiceCost(const int * residual, int count, int order, int * partition_order, int * parameters) {
+    // every partition has to be the same size and hold more than the warm-up, the finest one that does is summed up first,
+    // then each coarser one is made by adding up pairs of the finer one
+    int finest = 0;
+    while(finest < WRZ_FLAC_MAX_PARTITION_ORDER && (count & ((2 << finest) - 1)) == 0 && (count >> (finest + 1)) > order) finest++;
+
+    unsigned long long sums[1 << WRZ_FLAC_MAX_PARTITION_ORDER];
+    int size = count >> finest;
+    for(int part = 0; part < (1 << finest); part++) {
+        sums[part] = 0;
+        for(int i = (part == 0) ? order : part * size; i < (part + 1) * size; i++) sums[part] += ((unsigned int) residual[i] << 1) ^ (unsigned int) (residual[i] >> 31);
+    }
+
+    long long best = -1;
+    for(int p = finest; p >= 0; p--) {
+        long long cost = 0;
+        int tried[1 << WRZ_FLAC_MAX_PARTITION_ORDER];
+
+        for(int part = 0; part < (1 << p); part++) {
+            long long n = (count >> p) - ((part == 0) ? order : 0);
+            int k = 0;
+            while(k < 14 && ((unsigned long long) n << (k + 1)) < sums[part]) k++; // about log2 of the mean
+
+            tried[part] = k;
+            cost += 4 + n * (k + 1) + (long long) (sums[part] >> k);
+        }
+
+        if(best < 0 || cost < best) {
+            best = cost;
+            *partition_order = p;
+            memcpy(parameters, tried, (1 << p) * sizeof(int));
+        }
+
+        for(int part = 0; part < (1 << p) / 2; part++) sums[part] = sums[part * 2] + sums[part * 2 + 1];
+    }
+
+    return best + 6; // coding method and partition order
+}
+
+// picks whichever of constant, fixed order 0 to 4 and verbatim is smallest for one channel of a frame
+void wrzFlacWriteSubframe(wrzBitWriter * w, const int * samples, int count, int bits_per_sample, int * residual) {
+    bool constant = true;
+    for(int i = 1; i < count && constant; i++) constant = (samples[i] == samples[0]);
+
+    if(constant) { // silence, which is most of a click track
+        wrzPutBits(w, 0x00, 8);
+        wrzPutBits(w, (unsigned int) samples[0], bits_per_sample);
+        return;
+    }
+
+    long long best_cost = (long long) count * bits_per_sample; // verbatim
+    int best_order = -1;
+    for(int order = 0; order <= 4 && order < count; order++) {
+        int partition_order, parameters[1 << WRZ_FLAC_MAX_PARTITION_ORDER];
+        wrzFixedResidual(samples, count, order, residual);
+
+        long long cost = (long long) order * bits_per_sample + wrzRiceCost(residual, count, order, &partition_order, parameters);
+        if(cost < best_cost) { best_cost = cost; best_order = order; }
+    }
+
+    if(best_order < 0) {
+        wrzPutBits(w, 0x02, 8);
+        for(int i = 0; i < count; i++) wrzPutBits(w, (unsigned int) samples[i], bits_per_sample);
+        return;
+    }
+
+    int partition_order, parameters[1 << WRZ_FLAC_MAX_PARTITION_ORDER];
+    wrzFixedResidual(samples, count, best_order, residual);
+    wrzRiceCost(residual, count, best_order, &partition_order, parameters);
+
+    wrzPutBits(w, (0x08 | best_order) << 1, 8);
+    for(int i = 0; i < best_order; i++) wrzPutBits(w, (unsigned int) samples[i], bits_per_sample); // warm-up samples
+    wrzPutBits(w, 0, 2); // rice with 4-bit parameters
+    wrzPutBits(w, partition_order, 4);
+
+    int size = count >> partition_order;
+    for(int part = 0; part < (1 << partition_order); part++) {
+        wrzPutBits(w, parameters[part], 4);
+        for(int i = (part == 0) ? best_order : part * size; i < (part + 1) * size; i++) wrzPutRice(w, residual[i], parameters[part]);
+    }
+}
+
+// encodes the pending frames as one flac frame and writes it out
+void wrzFlacWriteFrame(wrzFlacEncoder * enc) {
+    int count = enc->pending;
+    wrzBitWriter w = { enc->frame, 0, 0, 0 };
+
+    wrzPutBits(&w, 0x3FFE, 14); // sync code
+    wrzPutBits(&w, 0, 2); // reserved, fixed block size
+    wrzPutBits(&w, 0x7, 4); // block size is in 16 bits at the end of the header
+    wrzPutBits(&w, (WRZ_SAMPLE_RATE == 48000) ? 0xA : (WRZ_SAMPLE_RATE == 44100) ? 0x9 : 0x0, 4); // 0 means look in STREAMINFO
+    wrzPutBits(&w, 0x8, 4); // left and side, the clicks are the same on both sides so the side is all silence
+    wrzPutBits(&w, 0x4, 3); // 16 bits per sample
+    wrzPutBits(&w, 0, 1);
+
+    // the frame number, utf-8 style
+    unsigned long long number = (unsigned long long) enc->frame_number;
+    if(number < 0x80) {
+        wrzPutBits(&w, (unsigned int) number, 8);
+    } else {
+        int length = 2;
+        while(length < 7 && number >= (1ull << (5 * length + 1))) length++;
+        wrzPutBits(&w, ((0xFF00u >> length) & 0xFF) | (unsigned int) (number >> (6 * (length - 1))), 8);
+        for(int i = length - 2; i >= 0; i--) wrzPutBits(&w, 0x80 | (unsigned int) ((number >> (6 * i)) & 0x3F), 8);
+    }
+
+    wrzPutBits(&w, count - 1, 16);
+    wrzPutBits(&w, wrzCrc8(w.data, w.bytes), 8);
+
+    wrzFlacWriteSubframe(&w, enc->samples[0], count, 16, enc->residual);
+    wrzFlacWriteSubframe(&w, enc->samples[1], count, 17, enc->residual);
+
+    wrzPadBits(&w);
+    wrzPutBits(&w, wrzCrc16(w.data, w.bytes), 16);
+
+    fwrite(w.data, 1, w.bytes, enc->file);
+
+    if(enc->frame_number == 0 || (int) w.bytes < enc->min_frame_bytes) enc->min_frame_bytes = (int) w.bytes;
+    if((int) w.bytes > enc->max_frame_bytes) enc->max_frame_bytes = (int) w.bytes;
+    enc->frame_number++;
+    enc->pending = 0;
+}
+
+// the "fLaC" marker and STREAMINFO, written with unknown sizes first and again with the real ones by wrzFinishFlac()
+void wrzWriteFlacHeader(wrzFlacEncoder * enc) {
+    unsigned char header[42];
+    wrzBitWriter w = { header, 0, 0, 0 };
+
+    memcpy(header, "fLaC", 4);
+    w.bytes = 4;
+    wrzPutBits(&w, 0x80, 8); // the last (and only) metadata block, STREAMINFO
+    wrzPutBits(&w, 34, 24);
+
+    wrzPutBits(&w, WRZ_FLAC_BLOCK, 16);
+    wrzPutBits(&w, WRZ_FLAC_BLOCK, 16);
+    wrzPutBits(&w, enc->min_frame_bytes, 24);
+    wrzPutBits(&w, enc->max_frame_bytes, 24);
+    wrzPutBits(&w, WRZ_SAMPLE_RATE, 20);
+    wrzPutBits(&w, 2 - 1, 3); // channels
+    wrzPutBits(&w, 16 - 1, 5); // bits per sample
+    wrzPutBits(&w, (unsigned int) (enc->total_frames >> 32), 4);
+    wrzPutBits(&w, (unsigned int) enc->total_frames, 32);
+    for(int i = 0; i < 4; i++) wrzPutBits(&w, 0, 32); // no md5, which flac allows
+
+    fwrite(header, 1, sizeof(header), enc->file);
+}
+
+void wrzInitFlacEncoder(wrzFlacEncoder * enc, FILE * file) {
+    memset(enc, 0, sizeof(wrzFlacEncoder));
+    enc->file = file;
+    wrzWriteFlacHeader(enc);
+}
+
+// `block` is stereo interleaved, like wrzRenderClicks() writes it, and is quantized the same way as wrzWritePcm16()
+void wrzFlacWrite(wrzFlacEncoder * enc, const float * block, unsigned int frames) {
+    for(unsigned int i = 0; i < frames; i++) {
+        int left = (short) lrintf(block[i * 2] * 32767.0f);
+        int right = (short) lrintf(block[i * 2 + 1] * 32767.0f);
+
+        enc->samples[0][enc->pending] = left;
+        enc->samples[1][enc->pending] = left - right;
+        enc->total_frames++;
+
+        if(++enc->pending == WRZ_FLAC_BLOCK) wrzFlacWriteFrame(enc);
+    }
+}
+
+// writes whatever is left as a shorter last frame, then goes back and fills in the real sizes, if the file is not a pipe
+void wrzFinishFlac(wrzFlacEncoder * enc) {
+    if(enc->pending > 0) wrzFlacWriteFrame(enc);
+    if(fseek(enc->file, 0, SEEK_SET) == 0) wrzWriteFlacHeader(enc);
+}
+
+// flac if `path` ends in .flac, using `encoder` (which must stay around until wrzCloseTrackOutput()), otherwise a 16-bit wav
+bool wrzOpenTrackOutput(wrzTrackOutput * out, const char * path, wrzFlacEncoder * encoder) {
+    size_t length = strlen(path);
+    bool flac = length >= 5 && strcmp(path + length - 5, ".flac") == 0;
+
+    out->file = fopen(path, "wb");
+    out->flac = flac ? encoder : NULL;
+    out->frames = 0;
+    if(out->file == NULL) return false;
+
+    if(flac) wrzInitFlacEncoder(encoder, out->file);
+    else wrzWriteWavHeader(out->file, -1);
+
+    return true;
+}
+
+void wrzWriteTrack(wrzTrackOutput * out, const float * block, unsigned int frames) {
+    if(out->flac != NULL) wrzFlacWrite(out->flac, block, frames);
+    else wrzWritePcm16(out->file, block, frames);
+    out->frames += frames;
+}
+
+// returns how big the file came out, in bytes
+long wrzCloseTrackOutput(wrzTrackOutput * out) {
+    if(out->flac != NULL) wrzFinishFlac(out->flac);
+    else wrzFinishWav(out->file, out->frames);
+
+    fseek(out->file, 0, SEEK_END); // the finishing touches went back to the header
+    long size = ftell(out->file);
+    fclose(out->file);
+
+    return size;
+}
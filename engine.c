@@ -0,0 +1,653 @@
+// the clock, the counters and tracing, the beat sounds, and the click engine that turns a tempo into sample-accurate clicks
+#include "metronome.h"
+
+double wrzNow(void) { // monotonic seconds, safe to call from any thread and without a window
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+wrzCounters wrz_counters = { 0 }; // everything worth knowing about how the program is keeping time, see wrzDrawCounters()
+
+void wrzRecordStat(wrzStat * stat, double value) { // only call this from the thread that owns `stat`
+    long long count = atomic_load_explicit(&stat->count, memory_order_relaxed);
+
+    if(count == 0 || value < atomic_load_explicit(&stat->min, memory_order_relaxed)) atomic_store_explicit(&stat->min, value, memory_order_relaxed);
+    if(count == 0 || value > atomic_load_explicit(&stat->max, memory_order_relaxed)) atomic_store_explicit(&stat->max, value, memory_order_relaxed);
+    atomic_store_explicit(&stat->total, atomic_load_explicit(&stat->total, memory_order_relaxed) + value, memory_order_relaxed);
+    atomic_store_explicit(&stat->last, value, memory_order_relaxed);
+    atomic_store_explicit(&stat->count, count + 1, memory_order_release);
+}
+
+void wrzDumpStat(FILE * f, const char * name, wrzStat * stat, bool last) {
+    long long count = atomic_load(&stat->count);
+    fprintf(f, "    \"%s\": { \"count\": %lld, \"last\": %.4f, \"min\": %.4f, \"max\": %.4f, \"mean\": %.4f }%s\n", name, count,
+        atomic_load(&stat->last), atomic_load(&stat->min), atomic_load(&stat->max), (count > 0) ? atomic_load(&stat->total) / count : 0.0, last ? "" : ",");
+}
+
+// writes every counter as one json object, times are in milliseconds
+void wrzDumpCounters(FILE * f) {
+    fprintf(f, "{\n  \"gui\": {\n");
+    wrzDumpStat(f, "frame_time_ms", &wrz_counters.gui.frame_time, false);
+    wrzDumpStat(f, "present_error_ms", &wrz_counters.gui.present_error, false);
+    fprintf(f, "    \"allocations\": %lld,\n    \"allocating_frames\": %lld\n  },\n  \"audio\": {\n", atomic_load(&wrz_counters.gui.allocations), atomic_load(&wrz_counters.gui.allocating_frames));
+    wrzDumpStat(f, "callback_time_ms", &wrz_counters.audio.callback_time, false);
+    wrzDumpStat(f, "deadline_margin_ms", &wrz_counters.audio.deadline_margin, false);
+    wrzDumpStat(f, "click_offset_ms", &wrz_counters.audio.click_offset, false);
+    fprintf(f, "    \"underruns\": %lld,\n    \"allocations\": %lld,\n    \"allocating_callbacks\": %lld\n  },\n  \"sync\": {\n", atomic_load(&wrz_counters.audio.underruns),
+        atomic_load(&wrz_counters.audio.allocations), atomic_load(&wrz_counters.audio.allocating_callbacks));
+    wrzDumpStat(f, "phase_error_ms", &wrz_counters.sync.phase_error, false);
+    fprintf(f, "    \"packets\": %lld\n  },\n  \"server\": {\n", atomic_load(&wrz_counters.sync.packets));
+    wrzDumpStat(f, "tick_time_ms", &wrz_counters.server.tick_time, false);
+    fprintf(f, "    \"late_ticks\": %lld\n  }\n}\n", atomic_load(&wrz_counters.server.late_ticks));
+}
+
+void wrzSaveCounters(const char * path) { // NULL for stdout
+    FILE * f = (path != NULL) ? fopen(path, "w") : stdout;
+
+    if(f == NULL) {
+        printf("WARNING: STATS: Could not open \"%s\" for writing.\n", path);
+        return;
+    }
+
+    wrzDumpCounters(f);
+
+    if(path != NULL) {
+        fclose(f);
+        printf("INFO: STATS: Wrote counters to \"%s\".\n", path);
+    } else fflush(f);
+}
+
+_Atomic int wrz_dump_requested = 0; // set by SIGUSR1, the main loop does the actual writing since fprintf() isn't signal safe
+
+void wrzHandleDumpSignal(int signal) {
+    (void) signal;
+    atomic_store(&wrz_dump_requested, 1);
+}
+
+_Atomic int wrz_stop_requested = 0; // set by SIGINT and SIGTERM in the headless modes, which have no window to close
+
+void wrzHandleStopSignal(int signal) {
+    (void) signal;
+    atomic_store(&wrz_stop_requested, 1);
+}
+
+#ifdef WRZ_TRACK_ALLOCS
+// built with `make build TRACK_ALLOCS=1`, which links with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+// this catches everything linked statically, including a static raylib, but not what a shared library allocates internally
+_Thread_local _Atomic long long * wrz_thread_allocations = NULL; // which counter this thread's allocations go to, if any
+
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+
+void * __wrap_malloc(size_t size) {
+    if(wrz_thread_allocations != NULL) atomic_fetch_add_explicit(wrz_thread_allocations, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size) {
+    if(wrz_thread_allocations != NULL) atomic_fetch_add_explicit(wrz_thread_allocations, 1, memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * ptr, size_t size) {
+    if(wrz_thread_allocations != NULL) atomic_fetch_add_explicit(wrz_thread_allocations, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+#endif
+
+// call once a frame, after EndDrawing(), so a frame that allocated anything counts against it when `steady` says it shouldn't have
+// `seen` is the gui's allocation count as of the previous call
+void wrzAuditFrameAllocations(long long * seen, bool steady) {
+    long long now = atomic_load(&wrz_counters.gui.allocations);
+    if(steady && now != *seen) atomic_fetch_add(&wrz_counters.gui.allocating_frames, 1);
+    *seen = now;
+}
+
+//------------------------------------------------------------------------------
+
+// tracing: off unless --trace is given, in which case every thread that calls wrzTraceThread() records into its own ring
+// the rings are only read by wrzSaveTrace() once the other threads are done, so recording is just a few stores
+
+wrzTraceBuffer wrz_trace_buffers[WRZ_TRACE_THREADS] = { 0 };
+_Atomic int wrz_trace_thread_count = 0;
+double wrz_trace_epoch = 0.0; // wrzNow() when tracing started, 0 if tracing is off
+
+_Thread_local wrzTraceBuffer * wrz_trace_buffer = NULL; // this thread's ring, NULL if it doesn't record
+
+void wrzStartTracing(void) {
+    // everything is allocated up front so that threads joining later (the audio thread) don't have to
+    for(int i = 0; i < WRZ_TRACE_THREADS; i++) wrz_trace_buffers[i].events = calloc(WRZ_TRACE_EVENTS, sizeof(wrzTraceEvent));
+    wrz_trace_epoch = wrzNow();
+}
+
+// claims a ring for the calling thread, does nothing if tracing is off or every ring is taken
+void wrzTraceThread(const char * thread_name) {
+    if(wrz_trace_epoch == 0.0) return;
+
+    int index = atomic_fetch_add(&wrz_trace_thread_count, 1);
+    if(index >= WRZ_TRACE_THREADS) return;
+
+    wrz_trace_buffers[index].thread_name = thread_name;
+    wrz_trace_buffer = &wrz_trace_buffers[index];
+}
+
+double wrzTraceBegin(void) { // returns the start time to hand to wrzTraceEnd()
+    return (wrz_trace_buffer != NULL) ? wrzNow() : 0.0;
+}
+
+void wrzTraceRecord(const char * name, char phase, double start, double end, const char * arg_name, long long arg) {
+    if(wrz_trace_buffer == NULL) return;
+
+    long long written = atomic_load_explicit(&wrz_trace_buffer->written, memory_order_relaxed);
+    wrzTraceEvent * event = &wrz_trace_buffer->events[written % WRZ_TRACE_EVENTS];
+
+    event->name = name;
+    event->arg_name = arg_name;
+    event->phase = phase;
+    event->start = (start - wrz_trace_epoch) * 1e6;
+    event->duration = (end - start) * 1e6;
+    event->arg = arg;
+
+    atomic_store_explicit(&wrz_trace_buffer->written, written + 1, memory_order_release);
+}
+
+// records a span from `start` (from wrzTraceBegin()) until now
+void wrzTraceEnd(const char * name, double start, const char * arg_name, long long arg) {
+    if(wrz_trace_buffer != NULL) wrzTraceRecord(name, 'X', start, wrzNow(), arg_name, arg);
+}
+
+void wrzTraceInstant(const char * name, const char * arg_name, long long arg) {
+    if(wrz_trace_buffer == NULL) return;
+
+    double now = wrzNow();
+    wrzTraceRecord(name, 'i', now, now, arg_name, arg);
+}
+
+// writes every ring out as chrome trace json (chrome://tracing or ui.perfetto.dev), only call once the recording threads are done
+void wrzSaveTrace(const char * path) {
+    FILE * f = fopen(path, "w");
+
+    if(f == NULL) {
+        printf("WARNING: TRACE: Could not open \"%s\" for writing.\n", path);
+        return;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    long long total = 0;
+    int threads = atomic_load(&wrz_trace_thread_count);
+    if(threads > WRZ_TRACE_THREADS) threads = WRZ_TRACE_THREADS;
+
+    for(int t = 0; t < threads; t++) {
+        wrzTraceBuffer * buffer = &wrz_trace_buffers[t];
+        fprintf(f, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}", (t > 0) ? ",\n" : "", t + 1, buffer->thread_name);
+
+        long long written = atomic_load(&buffer->written);
+        long long first = (written > WRZ_TRACE_EVENTS) ? written - WRZ_TRACE_EVENTS : 0; // oldest event that hasn't been overwritten
+
+        for(long long i = first; i < written; i++) {
+            wrzTraceEvent * event = &buffer->events[i % WRZ_TRACE_EVENTS];
+
+            fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"%c\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f", event->name, event->phase, t + 1, event->start);
+            if(event->phase == 'X') fprintf(f, ", \"dur\": %.3f", event->duration);
+            else fprintf(f, ", \"s\": \"t\"");
+            if(event->arg_name != NULL) fprintf(f, ", \"args\": {\"%s\": %lld}", event->arg_name, event->arg);
+            fprintf(f, "}");
+        }
+
+        total += written - first;
+    }
+
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    printf("INFO: TRACE: Wrote %lld events from %d thread(s) to \"%s\".\n", total, threads, path);
+}
+
+void wrzStopTracing(void) {
+    for(int i = 0; i < WRZ_TRACE_THREADS; i++) free(wrz_trace_buffers[i].events);
+    wrz_trace_epoch = 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+// decodes `path` to mono float at WRZ_SAMPLE_RATE and finds where the sound actually is
+// fills in `sample->frame_count` and `sample->onset_frames`, and `trim_start`, the first frame of the decoded buffer that is kept
+// returns the full decoded buffer (free with UnloadWaveSamples()), or NULL if the file could not be loaded
+float * wrzAnalyzeBeatSample(const char * path, wrzBeatSample * sample, int * trim_start) {
+    sample->data = NULL;
+    sample->frame_count = 0;
+    sample->onset_frames = 0;
+    *trim_start = 0;
+
+    Wave wave = LoadWave(path);
+
+    if(wave.data == NULL || wave.frameCount == 0) {
+        printf("WARNING: Could not decode \"%s\", it will play as silence.\n", path);
+        UnloadWave(wave);
+        return NULL;
+    }
+
+    WaveFormat(&wave, WRZ_SAMPLE_RATE, 32, 1); // the click engine mixes mono float, so do the conversion once here
+    float * frames = LoadWaveSamples(wave);
+    int frame_count = wave.frameCount;
+    UnloadWave(wave);
+
+    float peak = 0.0f;
+    for(int i = 0; i < frame_count; i++) if(fabsf(frames[i]) > peak) peak = fabsf(frames[i]);
+
+    if(peak == 0.0f) {
+        printf("WARNING: \"%s\" is completely silent.\n", path);
+        return frames; // frame_count stays 0, so nothing gets copied out of it
+    }
+
+    // thresholds are relative to the peak so quiet samples get trimmed the same as loud ones
+    int first = 0, last = frame_count - 1, onset = 0;
+    while(first < frame_count && fabsf(frames[first]) < peak * WRZ_TRIM_THRESHOLD) first++;
+    while(last > first && fabsf(frames[last]) < peak * WRZ_TRIM_THRESHOLD) last--;
+    onset = first;
+    while(onset < last && fabsf(frames[onset]) < peak * WRZ_ONSET_THRESHOLD) onset++;
+
+    *trim_start = (first > WRZ_TRIM_PREROLL) ? first - WRZ_TRIM_PREROLL : 0;
+    sample->frame_count = last + 1 - *trim_start;
+    sample->onset_frames = onset - *trim_start;
+
+    printf("INFO: \"%s\": trimmed %.2f ms of leading and %.2f ms of trailing silence, onset at %.2f ms.\n", path,
+        (*trim_start * 1000.0f) / WRZ_SAMPLE_RATE, ((frame_count - 1 - last) * 1000.0f) / WRZ_SAMPLE_RATE,
+        (sample->onset_frames * 1000.0f) / WRZ_SAMPLE_RATE);
+
+    return frames;
+}
+
+// TODO: make this function skip non-audio files
+wrzBeatSounds wrzLoadBeatSounds(const char * dir) {
+    wrzBeatSounds output;
+
+    if(!DirectoryExists(dir)) {
+        printf("ERROR: Could not load beat sounds filepath \"%s\"! Check that this directory exists!\n", dir);
+        exit(1);
+    }
+
+    //------------------------------------------------------------------------------
+
+    // Raylib's supported filetypes -- wav, mp3, ogg, flac, and a few more but if you're that kind of nerd you can do it yourself
+    FilePathList wavs = LoadDirectoryFilesEx(dir, ".wav",  true);
+    FilePathList mp3s = LoadDirectoryFilesEx(dir, ".mp3",  true);
+    FilePathList oggs = LoadDirectoryFilesEx(dir, ".ogg",  true);
+    FilePathList flac = LoadDirectoryFilesEx(dir, ".flac", true);
+    // is it annoying that flac is not plural? less annoying than them not being all 4 characters, i think
+
+    // monolithic filepath since i don't think i can filter for multiple filetypes
+    FilePathList files = { 0 };
+
+    files.count = wavs.count + mp3s.count + oggs.count + flac.count;
+    files.paths = malloc(sizeof(char **) * files.count);
+
+    // please let me know if this is disgusting and bad
+    if(wavs.count > 0) for(int i = 0; i < wavs.count; i++) files.paths[i] = wavs.paths[i]; // copy wav paths
+    if(mp3s.count > 0) for(int j = 0; j < mp3s.count; j++) files.paths[j + wavs.count] = mp3s.paths[j]; // copy mp3 paths
+    if(oggs.count > 0) for(int k = 0; k < oggs.count; k++) files.paths[k + wavs.count + mp3s.count] = oggs.paths[k]; // ogg paths
+    if(flac.count > 0) for(int l = 0; l < flac.count; l++) files.paths[l + wavs.count + mp3s.count + oggs.count] = flac.paths[l]; // and the flac paths
+
+    free(wavs.paths); // discard the individual file lists
+    free(mp3s.paths);
+    free(oggs.paths);
+    free(flac.paths);
+
+    //------------------------------------------------------------------------------
+
+    if(files.count == 0) printf("WARNING: No files found in \"%s\". Attempting to load defaults...\n", dir);
+    else printf("INFO: `%s` contains %d file(s).\n", dir, files.count);
+
+    if(files.count == 0) { // if no files are found in the beats directory, load the default one
+        bool cooked = false;
+
+        if(FileExists("./resources/beats/default-beat.wav")) { // check the default primary beat
+            files.paths = realloc(files.paths, sizeof(char **));
+            files.paths[0] = "./resources/beats/default-beat.wav";
+            files.count = 1;
+        } else cooked = true; 
+        // if the primary and secondary file don't exist, we're probably cooked
+        
+        // redundant checks kept for clarity's sake
+        if(!FileExists("./resources/beats/default-beat.wav") && FileExists("./resources/beats/default-sub-beat.wav")) { 
+            // if the default primary click is gone, load the default sub click in its place
+            cooked = false; // we're not cooked
+            files.paths = realloc(files.paths, sizeof(char **));
+            files.paths[0] = "./resources/beats/default-sub-beat.wav";
+            files.count = 1;
+        } else if(FileExists("./resources/beats/default-beat.wav") && FileExists("./resources/beats/default-sub-beat.wav")) {
+            // if both default files are available, configure them correctly
+            files.paths = realloc(files.paths, 2 * sizeof(char **));
+            files.paths[1] = "./resources/beats/default-sub-beat.wav";
+            files.count = 2;
+        } // else, cooked remains true, and neither file is loaded
+        
+        // if both default files are missing, then things are truly over
+        if(cooked) {
+            printf("ERROR: \"%s\" is empty and the defaults are missing. The West has fallen.\n", dir);
+            exit(2);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+
+    // decode and analyze everything first, the arena can only be sized once we know how much of each sample survives trimming
+    output.samples = malloc(files.count * sizeof(wrzBeatSample));
+    output.count = files.count;
+    output.max_onset_frames = 0;
+
+    float ** decoded = malloc(files.count * sizeof(float *));
+    int * trim_start = malloc(files.count * sizeof(int));
+    int arena_frames = 0;
+
+    for(int i = 0; i < files.count; i++) {
+        double load_start = wrzTraceBegin();
+        decoded[i] = wrzAnalyzeBeatSample(files.paths[i], &output.samples[i], &trim_start[i]);
+        wrzTraceEnd("load sound", load_start, "index", i);
+
+        arena_frames += output.samples[i].frame_count;
+        if(output.samples[i].onset_frames > output.max_onset_frames) output.max_onset_frames = output.samples[i].onset_frames;
+    }
+
+    output.arena = malloc((arena_frames > 0 ? arena_frames : 1) * sizeof(float));
+
+    float * cursor = output.arena;
+    for(int i = 0; i < files.count; i++) {
+        wrzBeatSample * sample = &output.samples[i];
+        sample->data = cursor;
+
+        if(decoded[i] != NULL) {
+            memcpy(sample->data, decoded[i] + trim_start[i], sample->frame_count * sizeof(float));
+            UnloadWaveSamples(decoded[i]);
+        }
+
+        // fade out whatever is left of the tail so the cut doesn't pop
+        int fade = (sample->frame_count < WRZ_TRIM_FADE) ? sample->frame_count : WRZ_TRIM_FADE;
+        for(int f = 0; f < fade; f++) sample->data[sample->frame_count - fade + f] *= 1.0f - ((float) (f + 1) / fade);
+
+        cursor += sample->frame_count;
+    }
+
+    printf("INFO: Loaded %d beat sound(s), %d frames (%.1f KiB) after trimming.\n", output.count, arena_frames, (arena_frames * sizeof(float)) / 1024.0f);
+
+    free(decoded);
+    free(trim_start);
+    free(files.paths);
+
+    return output;
+}
+
+void wrzDestroyBeatSounds(wrzBeatSounds * b) {
+    free(b->samples);
+    free(b->arena);
+}
+
+// loads `directory` the first time it is asked for, after that it hands out the same sounds, which are only ever read
+wrzBeatSounds * wrzGetBeatSounds(wrzSoundLibrary * library, const char * directory) {
+    for(int i = 0; i < library->count; i++) {
+        if(strcmp(library->directories[i], directory) == 0) return library->sounds[i];
+    }
+
+    if(library->count == library->capacity) {
+        library->capacity = (library->capacity > 0) ? library->capacity * 2 : 4;
+        library->directories = realloc(library->directories, library->capacity * sizeof(char *));
+        library->sounds = realloc(library->sounds, library->capacity * sizeof(wrzBeatSounds *));
+    }
+
+    library->directories[library->count] = strdup(directory);
+    library->sounds[library->count] = malloc(sizeof(wrzBeatSounds));
+    *library->sounds[library->count] = wrzLoadBeatSounds(directory);
+
+    return library->sounds[library->count++];
+}
+
+void wrzDestroySoundLibrary(wrzSoundLibrary * library) {
+    for(int i = 0; i < library->count; i++) {
+        wrzDestroyBeatSounds(library->sounds[i]);
+        free(library->sounds[i]);
+        free(library->directories[i]);
+    }
+
+    free(library->sounds);
+    free(library->directories);
+}
+
+//------------------------------------------------------------------------------
+
+void wrzInitClickEngine(wrzClickEngine * e, wrzBeatSounds * sounds, int beat_idx, int sub_beat_idx) {
+    memset(e, 0, sizeof(wrzClickEngine));
+
+    e->sounds = sounds;
+    atomic_store(&e->bpm, 60.0);
+    atomic_store(&e->subdivision, 1);
+    atomic_store(&e->beat_idx, beat_idx);
+    atomic_store(&e->sub_beat_idx, sub_beat_idx);
+    atomic_store(&e->tempo_scale, 1.0);
+    e->click_offset = &wrz_counters.audio.click_offset;
+
+    // the very first click lands late enough that even the slowest onset can be started on time
+    e->last_grid_frame = sounds->max_onset_frames;
+
+    e->ticks_sent = WRZ_MIDI_PPQN; // no clock until the first beat
+}
+
+void wrzPushMidiEvent(wrzMidiQueue * q, wrzMidiEventType type, double time) {
+    long long head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if(head - atomic_load_explicit(&q->tail, memory_order_acquire) >= WRZ_MIDI_QUEUE) return; // full, the midi thread has fallen behind
+
+    q->events[head % WRZ_MIDI_QUEUE] = (wrzMidiEvent) { type, time };
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
+
+// sends the clock ticks of the current beat that fall before frame `until`
+void wrzFlushMidiClock(wrzClickEngine * e, double until, unsigned long long clock) {
+    while(e->ticks_sent < WRZ_MIDI_PPQN) {
+        double frame = e->tick_anchor + e->ticks_sent * e->tick_spacing;
+        if(frame >= until) break;
+
+        wrzPushMidiEvent(e->midi, WRZ_MIDI_CLOCK, e->block_time + (frame - (double) clock) / WRZ_SAMPLE_RATE);
+        e->ticks_sent++;
+    }
+}
+
+unsigned long long wrzHashBytes(unsigned long long hash, const void * data, size_t length) { // 64-bit fnv-1a, start with 14695981039346656037
+    const unsigned char * bytes = data;
+    for(size_t i = 0; i < length; i++) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+
+// called by the audio thread, so it only ever copies into the ring, see wrzDrainReplayRecorder() for where it goes from there
+void wrzPushReplayBlock(wrzReplayRecorder * r, const wrzReplayBlock * block) {
+    if(atomic_load_explicit(&r->overflowed, memory_order_relaxed)) return;
+
+    long long written = atomic_load_explicit(&r->written, memory_order_relaxed);
+    if(written - atomic_load_explicit(&r->drained, memory_order_acquire) >= WRZ_REPLAY_RING) {
+        atomic_store(&r->overflowed, 1);
+        return;
+    }
+
+    r->blocks[written % WRZ_REPLAY_RING] = *block;
+    atomic_store_explicit(&r->written, written + 1, memory_order_release);
+}
+
+// mixes every click that starts in the next `frames` frames into `out` (stereo interleaved, overwritten)
+// clicks are placed so that their onset, not their first frame, lands on the beat
+void wrzRenderClicks(wrzClickEngine * e, float * out, unsigned int frames) {
+    unsigned long long clock = atomic_load(&e->frame_clock);
+    unsigned long long block_end = clock + frames;
+
+    long long gui_frame = atomic_load(&e->gui_frame); // before and after everything the gui hands over, so --record knows which frame it came from
+
+    double anchor = atomic_exchange(&e->phase_anchor, 0.0); // before the tempo, which the gui sets first, so both are from the same tap
+
+    double bpm = atomic_load(&e->bpm);
+    int subdivision = atomic_load(&e->subdivision);
+    double tempo_scale = atomic_load(&e->tempo_scale);
+    double scaled_bpm = bpm * tempo_scale; // only ever off 1.0 while following another metronome
+
+    // read once, so a sound picked halfway through a block can't change what --record says the block was made of
+    int beat_idx = atomic_load(&e->beat_idx), sub_beat_idx = atomic_load(&e->sub_beat_idx);
+    if(atomic_load(&e->gui_frame) != gui_frame) gui_frame |= 1; // the gui was handing a frame over meanwhile, these could be from either one
+
+    // a tap moves the grid so that the next beat lands a whole number of beats after it, see wrzTap()
+    if(anchor > 0.0 && bpm >= 1.0 && subdivision >= 1) {
+        double beat_frames = (60.0 * WRZ_SAMPLE_RATE) / scaled_bpm;
+        double tap_frame = (double) clock + (anchor - e->block_time) * WRZ_SAMPLE_RATE; // already heard, so this is behind the clock
+        double next_beat = tap_frame + ceil(((double) clock + e->sounds->max_onset_frames - tap_frame) / beat_frames) * beat_frames;
+
+        e->last_grid_frame = (e->clicks_scheduled == 0) ? next_beat : next_beat - beat_frames / subdivision;
+        e->sub_play_counter = 0;
+    }
+
+    // a follower that is too far out of phase moves its whole grid at once, and then skips whatever clicks that left behind it
+    double jump = atomic_exchange(&e->phase_jump, 0.0);
+    if(jump != 0.0 && bpm >= 1.0) e->last_grid_frame -= jump * (60.0 * WRZ_SAMPLE_RATE) / scaled_bpm;
+
+    // the spacing is recomputed every block, so tempo changes take effect from the last click like they always have
+    while(bpm >= 1.0 && subdivision >= 1) {
+        double spacing = (60.0 * WRZ_SAMPLE_RATE) / (scaled_bpm * subdivision); // frames per click
+        double grid = (e->clicks_scheduled == 0) ? e->last_grid_frame : e->last_grid_frame + spacing;
+
+        wrzBeatSample * sample = &e->sounds->samples[(e->sub_play_counter > 0) ? sub_beat_idx : beat_idx];
+        long long start = llround(grid) - sample->onset_frames;
+
+        if(start >= (long long) block_end) break;
+
+        if(e->clicks_scheduled > 0) e->beat_position += 1.0 / subdivision;
+        if(e->sub_play_counter == 0) e->beat_position = round(e->beat_position); // beats stay whole numbers across subdivision changes
+
+        if(jump == 0.0 || llround(grid) >= (long long) clock) {
+            // take a free voice, or steal the one that has been ringing longest
+            wrzVoice * voice = &e->voices[0];
+            for(int v = 0; v < WRZ_MAX_VOICES; v++) {
+                if(e->voices[v].sample == NULL) { voice = &e->voices[v]; break; }
+                if(e->voices[v].position > voice->position) voice = &e->voices[v];
+            }
+
+            // the onset lands on the nearest frame to the grid, unless the click had to be scheduled in the past (tempo change)
+            // then it starts from its first frame at the clock, so the attack is still heard, and its onset is late by however much that moved it
+            long long actual_onset = llround(grid);
+            if(start < (long long) clock) {
+                start = (long long) clock;
+                actual_onset = start + sample->onset_frames;
+            }
+
+            voice->sample = sample;
+            voice->position = (long long) clock - start; // negative means it starts partway into this block
+
+            if(e->click_offset != NULL) wrzRecordStat(e->click_offset, ((actual_onset - grid) * 1000.0) / WRZ_SAMPLE_RATE);
+
+            // midi gets the same grid as the audio, the clock restarts on every beat so it can never drift away from the clicks
+            if(e->midi != NULL) {
+                if(e->sub_play_counter == 0) {
+                    wrzFlushMidiClock(e, grid, clock); // whatever is left of the previous beat comes first
+                    e->tick_anchor = grid;
+                    e->tick_spacing = spacing * subdivision / WRZ_MIDI_PPQN;
+                    e->ticks_sent = 0;
+                }
+
+                wrzPushMidiEvent(e->midi, (e->sub_play_counter > 0) ? WRZ_MIDI_SUB_BEAT : WRZ_MIDI_BEAT, e->block_time + (grid - (double) clock) / WRZ_SAMPLE_RATE);
+            }
+
+            wrzTraceInstant((e->sub_play_counter > 0) ? "schedule sub-beat" : "schedule beat", "onset_frame", llround(grid));
+
+            long long count = atomic_load(&e->click_count);
+            atomic_store(&e->click_history[count % WRZ_CLICK_HISTORY], (unsigned long long) actual_onset); // where it is actually heard
+            atomic_store(&e->click_count, count + 1);
+        }
+
+        e->last_grid_frame = grid;
+        e->clicks_scheduled++;
+
+        if(subdivision > 1) e->sub_play_counter = (e->sub_play_counter + 1) % subdivision; // increment the subdivision counter with overflow
+        else e->sub_play_counter = 0; // if subdivision is 1, always play the main beat sound
+    }
+
+    // where the beat is, for network sync
+    unsigned int sequence = atomic_load_explicit(&e->beat_clock.sequence, memory_order_relaxed);
+    atomic_store_explicit(&e->beat_clock.sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&e->beat_clock.grid_frame, e->last_grid_frame, memory_order_relaxed);
+    atomic_store_explicit(&e->beat_clock.beat, e->beat_position, memory_order_relaxed);
+    atomic_store_explicit(&e->beat_clock.beat_frames, (bpm >= 1.0 && e->clicks_scheduled > 0) ? (60.0 * WRZ_SAMPLE_RATE) / scaled_bpm : 0.0, memory_order_relaxed);
+    atomic_store_explicit(&e->beat_clock.clock, clock, memory_order_relaxed);
+    atomic_store_explicit(&e->beat_clock.block_time, e->block_time, memory_order_relaxed);
+    atomic_store_explicit(&e->beat_clock.sequence, sequence + 2, memory_order_release);
+
+    if(e->midi != NULL) wrzFlushMidiClock(e, (double) block_end, clock);
+
+    memset(out, 0, frames * 2 * sizeof(float));
+
+    for(int v = 0; v < WRZ_MAX_VOICES; v++) {
+        wrzVoice * voice = &e->voices[v];
+        if(voice->sample == NULL) continue;
+
+        // only walk the part of the block that overlaps the sample
+        long long first = (voice->position < 0) ? -voice->position : 0;
+        long long last = voice->sample->frame_count - voice->position;
+        if(last > frames) last = frames;
+
+        for(long long i = first; i < last; i++) {
+            float value = voice->sample->data[voice->position + i];
+            out[i * 2] += value;
+            out[i * 2 + 1] += value;
+        }
+
+        voice->position += frames;
+        if(voice->position >= voice->sample->frame_count) voice->sample = NULL;
+    }
+
+    for(unsigned int i = 0; i < frames * 2; i++) out[i] = Clamp(out[i], -1.0f, 1.0f);
+
+    if(e->recorder != NULL) {
+        wrzReplayBlock block = { frames, e->block_time, bpm, tempo_scale, anchor, jump, subdivision, beat_idx, sub_beat_idx, gui_frame, 0 };
+        block.hash = wrzHashBytes(14695981039346656037ULL, out, frames * 2 * sizeof(float));
+        wrzPushReplayBlock(e->recorder, &block);
+    }
+
+    atomic_store(&e->frame_clock, block_end);
+}
+
+void wrzInitSession(wrzSession * s, wrzBeatSounds * sounds, int beat_idx, int sub_beat_idx, double bpm, int subdivision) {
+    memset(s, 0, sizeof(wrzSession));
+
+    s->sounds = sounds;
+    s->bpm = bpm;
+    s->subdivision = subdivision;
+    s->beat_idx = beat_idx;
+    s->sub_beat_idx = sub_beat_idx;
+
+    wrzInitClickEngine(&s->engine, sounds, beat_idx, sub_beat_idx);
+    atomic_store(&s->engine.bpm, bpm);
+    atomic_store(&s->engine.subdivision, subdivision);
+}
+
+void wrzReadBeatClock(wrzClickEngine * e, wrzBeatClockReading * reading) {
+    do {
+        reading->sequence = atomic_load_explicit(&e->beat_clock.sequence, memory_order_acquire);
+        reading->grid_frame = atomic_load_explicit(&e->beat_clock.grid_frame, memory_order_relaxed);
+        reading->beat = atomic_load_explicit(&e->beat_clock.beat, memory_order_relaxed);
+        reading->beat_frames = atomic_load_explicit(&e->beat_clock.beat_frames, memory_order_relaxed);
+        reading->clock = atomic_load_explicit(&e->beat_clock.clock, memory_order_relaxed);
+        reading->block_time = atomic_load_explicit(&e->beat_clock.block_time, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while((reading->sequence & 1) || reading->sequence != atomic_load_explicit(&e->beat_clock.sequence, memory_order_relaxed));
+}
+
+// how many beats in the engine was at the moment that is heard at wrzNow() == `time`, going by `reading`, NAN if it hadn't started yet
+double wrzBeatPositionIn(const wrzBeatClockReading * reading, double time) {
+    if(reading->beat_frames <= 0.0) return NAN;
+
+    double frame = (double) reading->clock + (time - reading->block_time) * WRZ_SAMPLE_RATE;
+    return reading->beat + (frame - reading->grid_frame) / reading->beat_frames;
+}
+
+// how many beats in the engine is at the moment that is heard at wrzNow() == `time`, NAN if it hasn't started yet
+double wrzBeatPositionAt(wrzClickEngine * e, double time) {
+    wrzBeatClockReading reading;
+    wrzReadBeatClock(e, &reading);
+    return wrzBeatPositionIn(&reading, time);
+}
@@ -0,0 +1,717 @@
+// the modes that run without a window: --calibrate, --server, --stream, --render, --batch and --stress
+#include "metronome.h"
+
+#ifndef _WIN32
+// every tick, each worker keeps taking WRZ_SERVER_CHUNK sessions until there are none left, so a slow session
+// (or a slow disk) only holds up the worker it landed on
+void * wrzServerWorkerThread(void * data) {
+    wrzServerWorker * worker = (wrzServerWorker *) data;
+    wrzServer * server = worker->server;
+    wrzTraceThread("server worker");
+
+    float block[WRZ_SERVER_BLOCK * 2];
+    long long last_tick = 0;
+
+    while(true) {
+        pthread_mutex_lock(&server->lock);
+        while(server->tick == last_tick && !server->stopping) pthread_cond_wait(&server->tick_started, &server->lock);
+        bool stopping = server->stopping;
+        last_tick = server->tick;
+        pthread_mutex_unlock(&server->lock);
+
+        if(stopping) break;
+
+        double start = wrzNow();
+
+        int first;
+        while((first = atomic_fetch_add(&server->next_session, WRZ_SERVER_CHUNK)) < server->session_count) {
+            for(int i = first; i < first + WRZ_SERVER_CHUNK && i < server->session_count; i++) {
+                wrzSession * session = &server->sessions[i];
+                wrzRenderClicks(&session->engine, block, WRZ_SERVER_BLOCK);
+                wrzWritePcm16(session->output, block, WRZ_SERVER_BLOCK);
+            }
+        }
+
+        worker->busy += wrzNow() - start;
+        wrzTraceRecord("render sessions", 'X', start, wrzNow(), "tick", last_tick);
+
+        pthread_mutex_lock(&server->lock);
+        if(++server->workers_done == server->worker_count) pthread_cond_signal(&server->tick_done);
+        pthread_mutex_unlock(&server->lock);
+    }
+
+    return NULL;
+}
+
+// renders one block of every session, returns once all of them are written
+void wrzServerTick(wrzServer * server, long long tick) {
+    pthread_mutex_lock(&server->lock);
+
+    server->tick = tick;
+    server->workers_done = 0;
+    atomic_store(&server->next_session, 0);
+    pthread_cond_broadcast(&server->tick_started);
+
+    while(server->workers_done < server->worker_count) pthread_cond_wait(&server->tick_done, &server->lock);
+
+    pthread_mutex_unlock(&server->lock);
+}
+#endif
+
+// --calibrate: measure the output latency through a loopback cable and save it to the config file, no window needed
+int wrzCalibrationMain(wrzCommandLine * args) {
+    wrzProgramConfig config = wrzLoadProgramConfig(CONFIGPATH);
+    wrzBeatSounds sounds = wrzLoadBeatSounds(config.beats_directory);
+
+    wrzClickEngine engine;
+    wrzInitClickEngine(&engine, &sounds, 0, 0); // calibrate with the first sound, any click will do
+
+    // the latency depends on the buffer size, so calibrate with the one that will be used
+    int period_frames = (args->period_frames >= 0) ? args->period_frames : config.audio_buffer_frames;
+    int periods = (args->periods >= 0) ? args->periods : config.audio_periods;
+
+    const char * backend_name = (args->audio_backend != NULL) ? args->audio_backend : config.audio_backend;
+
+    float latency_ms = wrzCalibrateLatency(&engine, backend_name, period_frames, periods);
+    if(latency_ms >= 0.0f) {
+        config.output_latency_ms = latency_ms;
+        wrzSaveProgramConfig(&config);
+    }
+
+    wrzDestroyBeatSounds(&sounds);
+    wrzDestroyProgramConfig(&config);
+
+    return (latency_ms >= 0.0f) ? 0 : 5;
+}
+
+// --server FILE: play every session in FILE at once, in real time, each into its own wav file (or named pipe), no window or sound card needed
+// every line of FILE is `OUTPUT BPM [SUBDIVISION [BEATSDIR [PRIMARY [SECONDARY]]]]`, anything left out comes from the config file, # starts a comment
+int wrzServerMain(wrzCommandLine * args) {
+#ifndef _WIN32
+    wrzProgramConfig config = wrzLoadProgramConfig(CONFIGPATH);
+
+    FILE * list = fopen(args->server_path, "r");
+    if(list == NULL) {
+        printf("ERROR: SERVER: Could not open session list \"%s\"!\n", args->server_path);
+        wrzDestroyProgramConfig(&config);
+        return 6;
+    }
+
+    int capacity = 16;
+    wrzServer * server = calloc(1, sizeof(wrzServer));
+    server->sessions = malloc(capacity * sizeof(wrzSession));
+
+    wrzSoundLibrary library = { 0 }; // sessions that play from the same directory share one copy of its sounds
+
+    char line[1024];
+    int line_no = 0;
+    while(fgets(line, sizeof(line), list) != NULL) {
+        line_no++;
+
+        char output_path[512], beats_directory[512];
+        double bpm = 0.0;
+        int subdivision = 1, primary = config.primary_beat_no, secondary = config.secondary_beat_no;
+        snprintf(beats_directory, sizeof(beats_directory), "%s", config.beats_directory);
+
+        if(line[0] == '#') continue;
+        int found = sscanf(line, "%511s %lf %d %511s %d %d", output_path, &bpm, &subdivision, beats_directory, &primary, &secondary);
+        if(found <= 0) continue; // blank line
+        if(found < 2 || bpm < 1.0 || bpm > WRZ_MAX_BPM || subdivision < 1 || subdivision > WRZ_MAX_SUBDIVISION) {
+            printf("WARNING: SERVER: Skipping line %d of \"%s\", it should be `OUTPUT BPM [SUBDIVISION [BEATSDIR [PRIMARY [SECONDARY]]]]`.\n", line_no, args->server_path);
+            continue;
+        }
+
+        if(server->session_count == capacity) {
+            capacity *= 2;
+            server->sessions = realloc(server->sessions, capacity * sizeof(wrzSession));
+        }
+
+        // wrzLoadBeatSounds() exits on a missing directory, which would take every other session down with this one
+        if(!DirectoryExists(beats_directory)) {
+            printf("WARNING: SERVER: Beats directory \"%s\" on line %d does not exist, skipping it.\n", beats_directory, line_no);
+            continue;
+        }
+
+        wrzBeatSounds * sounds = wrzGetBeatSounds(&library, beats_directory);
+        int beat_idx = (primary >= 1 && primary <= sounds->count) ? primary - 1 : 0;
+        int sub_beat_idx = (secondary >= 1 && secondary <= sounds->count) ? secondary - 1 : 0;
+
+        wrzSession * session = &server->sessions[server->session_count];
+        wrzInitSession(session, sounds, beat_idx, sub_beat_idx, bpm, subdivision);
+        session->engine.click_offset = NULL; // the workers would all be writing the same stat at once
+
+        session->output_path = strdup(output_path);
+        session->output = fopen(output_path, "wb");
+        if(session->output == NULL) {
+            printf("WARNING: SERVER: Could not open \"%s\" for writing, skipping it.\n", output_path);
+            free(session->output_path);
+            continue;
+        }
+
+        wrzWriteWavHeader(session->output, -1);
+        server->session_count++;
+    }
+    fclose(list);
+
+    if(server->session_count == 0) {
+        printf("ERROR: SERVER: No sessions to run in \"%s\"!\n", args->server_path);
+        free(server->sessions);
+        free(server);
+        wrzDestroySoundLibrary(&library);
+        wrzDestroyProgramConfig(&config);
+        return 6;
+    }
+
+    //------------------------------------------------------------------------------
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    server->worker_count = (args->workers > 0) ? args->workers : (cpus > 0 ? (int) cpus : 1);
+    if(server->worker_count > WRZ_SERVER_WORKERS) server->worker_count = WRZ_SERVER_WORKERS;
+
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->tick_started, NULL);
+    pthread_cond_init(&server->tick_done, NULL);
+
+    for(int w = 0; w < server->worker_count; w++) {
+        server->workers[w].server = server;
+        pthread_create(&server->workers[w].thread, NULL, wrzServerWorkerThread, &server->workers[w]);
+    }
+
+    signal(SIGINT, wrzHandleStopSignal);
+    signal(SIGTERM, wrzHandleStopSignal);
+
+    printf("INFO: SERVER: Running %d sessions with %d sound sets on %d workers, %d frames per block. Ctrl+C to stop.\n",
+        server->session_count, library.count, server->worker_count, WRZ_SERVER_BLOCK);
+
+    // the ticks are paced against when they are due rather than when the last one finished, so the outputs keep real time over hours
+    double start = wrzNow();
+    long long ticks = 0;
+    long long total_ticks = (long long) ceil(args->duration * WRZ_SAMPLE_RATE / WRZ_SERVER_BLOCK);
+
+    while(!atomic_load(&wrz_stop_requested) && (total_ticks == 0 || ticks < total_ticks)) {
+        double due = start + (double) ticks * WRZ_SERVER_BLOCK / WRZ_SAMPLE_RATE;
+        double now = wrzNow();
+
+        if(now < due) {
+            double wait = due - now;
+            struct timespec nap = { (time_t) wait, (long) ((wait - floor(wait)) * 1e9) };
+            nanosleep(&nap, NULL);
+        } else if(now - due > (double) WRZ_SERVER_BLOCK / WRZ_SAMPLE_RATE) {
+            atomic_fetch_add(&wrz_counters.server.late_ticks, 1);
+        }
+
+        double tick_start = wrzNow();
+        wrzServerTick(server, ++ticks);
+        wrzRecordStat(&wrz_counters.server.tick_time, (wrzNow() - tick_start) * 1000.0);
+
+        if(atomic_exchange(&wrz_dump_requested, 0)) wrzSaveCounters(args->stats_path);
+    }
+
+    pthread_mutex_lock(&server->lock);
+    server->stopping = true;
+    pthread_cond_broadcast(&server->tick_started);
+    pthread_mutex_unlock(&server->lock);
+
+    double busy = 0.0;
+    for(int w = 0; w < server->worker_count; w++) {
+        pthread_join(server->workers[w].thread, NULL);
+        busy += server->workers[w].busy;
+    }
+
+    //------------------------------------------------------------------------------
+
+    printf("INFO: SERVER: Rendered %.1f s of %d sessions, %.2f us of cpu per session per block, %lld late ticks.\n",
+        (double) ticks * WRZ_SERVER_BLOCK / WRZ_SAMPLE_RATE, server->session_count,
+        (ticks > 0) ? busy * 1e6 / ((double) ticks * server->session_count) : 0.0, atomic_load(&wrz_counters.server.late_ticks));
+
+    for(int i = 0; i < server->session_count; i++) {
+        wrzFinishWav(server->sessions[i].output, ticks * WRZ_SERVER_BLOCK);
+        fclose(server->sessions[i].output);
+        free(server->sessions[i].output_path);
+    }
+
+    wrzDestroySoundLibrary(&library);
+
+    if(args->stats_path != NULL) wrzSaveCounters(args->stats_path);
+
+    pthread_cond_destroy(&server->tick_done);
+    pthread_cond_destroy(&server->tick_started);
+    pthread_mutex_destroy(&server->lock);
+
+    free(server->sessions);
+    free(server);
+    wrzDestroyProgramConfig(&config);
+
+    return 0;
+#else
+    printf("ERROR: SERVER: --server is not supported on this platform yet.\n");
+    return 6;
+#endif
+}
+
+// --stream PATH: play the clicks into PATH as raw interleaved stereo pcm, for piping into an encoder or a recorder
+// nothing is kept around, so it can run for as long as whatever is reading it does
+// exits with 8 if PATH can't be opened or the options are out of range, the other headless modes each have their own code
+int wrzStreamMain(wrzCommandLine * args) {
+#ifndef _WIN32
+    // with "-" the pcm gets the real stdout to itself, and everything printed from here on goes to stderr instead
+    FILE * output;
+    if(strcmp(args->stream_path, "-") == 0) {
+        fflush(stdout);
+        output = fdopen(dup(STDOUT_FILENO), "wb");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    } else {
+        printf("INFO: STREAM: Opening \"%s\", a named pipe waits here until something reads it.\n", args->stream_path);
+        output = fopen(args->stream_path, "wb");
+    }
+
+    if(output == NULL) {
+        printf("ERROR: STREAM: Could not open \"%s\" for writing!\n", args->stream_path);
+        return 8;
+    }
+
+    const char * format_name = (args->format != NULL) ? args->format : "s16";
+    ma_format format = ma_format_unknown;
+    if(strcmp(format_name, "s16") == 0) format = ma_format_s16;
+    else if(strcmp(format_name, "s24") == 0) format = ma_format_s24; // packed, 3 bytes a sample
+    else if(strcmp(format_name, "s32") == 0) format = ma_format_s32;
+    else if(strcmp(format_name, "f32") == 0) format = ma_format_f32;
+
+    int rate = (args->rate > 0) ? args->rate : WRZ_SAMPLE_RATE;
+    double bpm = (args->bpm > 0.0) ? args->bpm : 60.0;
+    int subdivision = (args->subdivision > 0) ? args->subdivision : 1;
+
+    if(format == ma_format_unknown || rate < 8000 || rate > WRZ_STREAM_MAX_RATE || bpm < 1.0 || bpm > WRZ_MAX_BPM || subdivision > WRZ_MAX_SUBDIVISION) {
+        printf("ERROR: STREAM: --format must be s16, s24, s32 or f32, --rate 8000 to %d, --bpm 1 to %g and --subdivision 1 to %d.\n",
+            WRZ_STREAM_MAX_RATE, WRZ_MAX_BPM, WRZ_MAX_SUBDIVISION);
+        fclose(output);
+        return 8;
+    }
+
+    // the engine always renders float stereo at WRZ_SAMPLE_RATE, miniaudio (already in raylib) turns it into whatever was asked for
+    ma_data_converter_config converter_config = ma_data_converter_config_init(ma_format_f32, format, 2, 2, WRZ_SAMPLE_RATE, rate);
+    ma_data_converter converter;
+    if(ma_data_converter_init(&converter_config, NULL, &converter) != MA_SUCCESS) {
+        printf("ERROR: STREAM: Could not convert to %s at %d Hz!\n", format_name, rate);
+        fclose(output);
+        return 8;
+    }
+
+    wrzProgramConfig config = wrzLoadProgramConfig(CONFIGPATH);
+    wrzBeatSounds sounds = wrzLoadBeatSounds(config.beats_directory);
+
+    int beat_idx = (config.primary_beat_no >= 1 && config.primary_beat_no <= sounds.count) ? config.primary_beat_no - 1 : 0;
+    int sub_beat_idx = (config.secondary_beat_no >= 1 && config.secondary_beat_no <= sounds.count) ? config.secondary_beat_no - 1 : 0;
+
+    wrzSession session;
+    wrzInitSession(&session, &sounds, beat_idx, sub_beat_idx, bpm, subdivision);
+
+    ma_uint32 frame_bytes = ma_get_bytes_per_frame(format, 2);
+    ma_uint64 pcm_capacity = (ma_uint64) WRZ_STREAM_BLOCK * WRZ_STREAM_MAX_RATE / WRZ_SAMPLE_RATE + 64; // resampling can hold back or let out a few extra frames
+    unsigned char * pcm = malloc(pcm_capacity * frame_bytes);
+    float block[WRZ_STREAM_BLOCK * 2];
+
+    signal(SIGINT, wrzHandleStopSignal);
+    signal(SIGTERM, wrzHandleStopSignal);
+    signal(SIGPIPE, SIG_IGN); // a reader going away is just a failed write, not the end of the process
+
+    printf("INFO: STREAM: Writing %.7g bpm / %d as %s stereo at %d Hz, %s. Ctrl+C to stop.\n",
+        bpm, subdivision, format_name, rate, args->fast ? "as fast as it is read" : "in real time");
+
+    // paced against when each block is due, like wrzServerMain(), so the stream keeps real time however long it runs
+    double start = wrzNow();
+    long long blocks = 0;
+    long long total_blocks = (long long) ceil(args->duration * WRZ_SAMPLE_RATE / WRZ_STREAM_BLOCK);
+    long long written = 0;
+    bool reader_gone = false;
+
+    while(!atomic_load(&wrz_stop_requested) && !reader_gone && (total_blocks == 0 || blocks < total_blocks)) {
+        if(!args->fast) {
+            double wait = start + (double) blocks * WRZ_STREAM_BLOCK / WRZ_SAMPLE_RATE - wrzNow();
+            if(wait > 0.0) {
+                struct timespec nap = { (time_t) wait, (long) ((wait - floor(wait)) * 1e9) };
+                nanosleep(&nap, NULL);
+            }
+        }
+
+        session.engine.block_time = wrzNow();
+        wrzRenderClicks(&session.engine, block, WRZ_STREAM_BLOCK);
+        blocks++;
+
+        ma_uint64 consumed = 0;
+        while(consumed < WRZ_STREAM_BLOCK && !reader_gone) {
+            ma_uint64 frames_in = WRZ_STREAM_BLOCK - consumed, frames_out = pcm_capacity;
+            ma_data_converter_process_pcm_frames(&converter, block + consumed * 2, &frames_in, pcm, &frames_out);
+            if(frames_in == 0 && frames_out == 0) break;
+
+            if(fwrite(pcm, frame_bytes, frames_out, output) != frames_out) reader_gone = true;
+            written += frames_out;
+            consumed += frames_in;
+        }
+
+        if(!args->fast && fflush(output) != 0) reader_gone = true; // in real time each block goes out as soon as it is made
+    }
+
+    if(reader_gone) printf("INFO: STREAM: The reader went away, stopping.\n");
+    printf("INFO: STREAM: Wrote %.1f s (%lld frames).\n", (double) written / rate, written);
+
+    fclose(output);
+    free(pcm);
+    ma_data_converter_uninit(&converter, NULL);
+    wrzDestroyBeatSounds(&sounds);
+    wrzDestroyProgramConfig(&config);
+
+    return 0;
+#else
+    printf("ERROR: STREAM: --stream is not supported on this platform yet.\n");
+    return 8;
+#endif
+}
+
+// --render FILE: render a click track offline, encoding each block as soon as it is made, so memory doesn't grow with the length
+// FILE ending in .flac is compressed (losslessly), anything else is a 16-bit wav; prints how many times faster than real time it went
+// exits with 12 if the arguments are wrong or FILE can't be written
+int wrzRenderMain(wrzCommandLine * args) {
+    double bpm = (args->bpm > 0.0) ? args->bpm : 60.0;
+    int subdivision = (args->subdivision > 0) ? args->subdivision : 1;
+
+    if(args->duration <= 0.0 || bpm < 1.0 || bpm > WRZ_MAX_BPM || subdivision > WRZ_MAX_SUBDIVISION) {
+        printf("ERROR: RENDER: --render needs --duration SECONDS, and --bpm 1 to %g and --subdivision 1 to %d.\n", WRZ_MAX_BPM, WRZ_MAX_SUBDIVISION);
+        return 12;
+    }
+
+    static wrzFlacEncoder encoder; // ~100 KiB, too much for the stack
+    wrzTrackOutput output;
+    if(!wrzOpenTrackOutput(&output, args->render_path, &encoder)) {
+        printf("ERROR: RENDER: Could not open \"%s\" for writing!\n", args->render_path);
+        return 12;
+    }
+
+    wrzProgramConfig config = wrzLoadProgramConfig(CONFIGPATH);
+    wrzBeatSounds sounds = wrzLoadBeatSounds(config.beats_directory);
+
+    int beat_idx = (config.primary_beat_no >= 1 && config.primary_beat_no <= sounds.count) ? config.primary_beat_no - 1 : 0;
+    int sub_beat_idx = (config.secondary_beat_no >= 1 && config.secondary_beat_no <= sounds.count) ? config.secondary_beat_no - 1 : 0;
+
+    wrzSession session;
+    wrzInitSession(&session, &sounds, beat_idx, sub_beat_idx, bpm, subdivision);
+
+    float block[WRZ_RENDER_BLOCK * 2];
+    long long total = (long long) llround(args->duration * WRZ_SAMPLE_RATE);
+    double render_time = 0.0, encode_time = 0.0;
+
+    for(long long done = 0; done < total; done += WRZ_RENDER_BLOCK) {
+        unsigned int frames = (total - done < WRZ_RENDER_BLOCK) ? (unsigned int) (total - done) : WRZ_RENDER_BLOCK;
+
+        double start = wrzNow();
+        wrzRenderClicks(&session.engine, block, frames);
+        double rendered = wrzNow();
+
+        wrzWriteTrack(&output, block, frames);
+
+        render_time += rendered - start;
+        encode_time += wrzNow() - rendered;
+    }
+
+    double finish_start = wrzNow();
+    long size = wrzCloseTrackOutput(&output);
+    encode_time += wrzNow() - finish_start;
+
+    double seconds = (double) total / WRZ_SAMPLE_RATE;
+    printf("INFO: RENDER: Wrote %.1f s of %.7g bpm / %d to \"%s\", %.1f KiB (%.1f%% of 16-bit pcm).\n",
+        seconds, bpm, subdivision, args->render_path, size / 1024.0, 100.0 * size / ((double) total * 4));
+    printf("INFO: RENDER: Took %.3f s, %.0fx real time (rendering %.0fx, %s %.0fx).\n",
+        render_time + encode_time, seconds / (render_time + encode_time), seconds / render_time, (output.flac != NULL) ? "encoding" : "writing", seconds / encode_time);
+
+    wrzDestroyBeatSounds(&sounds);
+    wrzDestroyProgramConfig(&config);
+
+    return 0;
+}
+
+// a tempo map is `BEATS@BPM` segments separated by commas, like `32@120,64@132.5,8@90`, returns false if `text` isn't one
+bool wrzParseTempoMap(const char * text, wrzTempoSegment ** segments, int * count) {
+    int capacity = 0;
+    *segments = NULL;
+    *count = 0;
+
+    const char * cursor = text;
+    while(*cursor != '\0') {
+        char * end;
+        long beats = strtol(cursor, &end, 10);
+        if(end == cursor || *end != '@' || beats < 1) break;
+
+        cursor = end + 1;
+        double bpm = strtod(cursor, &end);
+        if(end == cursor || bpm < 1.0 || bpm > WRZ_MAX_BPM) break;
+
+        if(*count == capacity) {
+            capacity = (capacity > 0) ? capacity * 2 : 4;
+            *segments = realloc(*segments, capacity * sizeof(wrzTempoSegment));
+        }
+        (*segments)[(*count)++] = (wrzTempoSegment) { (int) beats, bpm };
+
+        cursor = end;
+        if(*cursor == ',') cursor++;
+        else if(*cursor != '\0') break;
+    }
+
+    if(*cursor != '\0' || *count == 0) {
+        free(*segments);
+        *segments = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+// renders one job's whole track, returns how many frames it came to, or -1 if its output couldn't be opened
+long long wrzRenderBatchJob(wrzBatchJob * job, wrzFlacEncoder * encoder) {
+    wrzTrackOutput output;
+    if(!wrzOpenTrackOutput(&output, job->output_path, encoder)) return -1;
+
+    wrzSession session;
+    wrzInitSession(&session, job->sounds, job->beat_idx, job->sub_beat_idx, job->tempo_map[0].bpm, job->subdivision);
+    session.engine.click_offset = NULL; // the workers would all be writing the same stat at once
+
+    float block[WRZ_RENDER_BLOCK * 2];
+    double grid = job->sounds->max_onset_frames; // where the next segment's first beat goes, the engine starts the first one here
+    int beat_onset = job->sounds->samples[job->beat_idx].onset_frames;
+    long long done = 0;
+
+    for(int seg = 0; seg < job->segment_count; seg++) {
+        atomic_store(&session.engine.bpm, job->tempo_map[seg].bpm);
+        grid += job->tempo_map[seg].beats * (60.0 * WRZ_SAMPLE_RATE) / job->tempo_map[seg].bpm;
+
+        // the engine spaces each click by the tempo it was given when the one before it was scheduled, so this segment is rendered up to
+        // just after the next one's first beat has started, which puts that beat at this tempo and every click after it at the next one
+        // the last segment stops where one more beat would start, so the track can be looped or laid end to end with the next one
+        long long until = (seg + 1 < job->segment_count) ? llround(grid) - beat_onset + 2 : llround(grid) - job->sounds->max_onset_frames;
+
+        while(done < until) {
+            unsigned int frames = (until - done < WRZ_RENDER_BLOCK) ? (unsigned int) (until - done) : WRZ_RENDER_BLOCK;
+            wrzRenderClicks(&session.engine, block, frames);
+            wrzWriteTrack(&output, block, frames);
+            done += frames;
+        }
+    }
+
+    wrzCloseTrackOutput(&output);
+    return done;
+}
+
+#ifndef _WIN32
+// each worker takes the next job nobody has started until there are none left, so a long track only holds up the worker it landed on
+void * wrzBatchWorkerThread(void * data) {
+    wrzBatch * batch = (wrzBatch *) data;
+    wrzTraceThread("batch worker");
+
+    wrzFlacEncoder * encoder = malloc(sizeof(wrzFlacEncoder));
+    if(encoder == NULL) printf("ERROR: BATCH: Out of memory for a worker's flac encoder, the tracks it takes will fail.\n");
+
+    int j;
+    while((j = atomic_fetch_add(&batch->next_job, 1)) < batch->job_count) {
+        wrzBatchJob * job = &batch->jobs[j];
+
+        if(encoder == NULL) {
+            printf("WARNING: BATCH: Skipping \"%s\", there is no encoder to render it with.\n", job->output_path);
+            atomic_fetch_add(&batch->failed, 1);
+            continue;
+        }
+
+        double start = wrzNow();
+        long long frames = wrzRenderBatchJob(job, encoder);
+
+        if(frames < 0) {
+            printf("WARNING: BATCH: Could not open \"%s\" for writing, skipping it.\n", job->output_path);
+            atomic_fetch_add(&batch->failed, 1);
+            continue;
+        }
+
+        atomic_fetch_add(&batch->frames_rendered, frames);
+        printf("INFO: BATCH: Wrote \"%s\", %.1f s in %d tempo(s), in %.3f s.\n", job->output_path, (double) frames / WRZ_SAMPLE_RATE, job->segment_count, wrzNow() - start);
+    }
+
+    free(encoder);
+    return NULL;
+}
+#endif
+
+// --batch FILE: render every click track listed in FILE, as fast as possible, spread over --workers threads
+// every line of FILE is `OUTPUT TEMPOMAP [SUBDIVISION [BEATSDIR [PRIMARY [SECONDARY]]]]` (see wrzParseTempoMap()), anything left out
+// comes from the config file, # starts a comment, and every track that plays from the same beats directory shares one copy of its sounds
+// exits with 13 if FILE can't be read, has nothing to render, or any track fails
+int wrzBatchMain(wrzCommandLine * args) {
+#ifndef _WIN32
+    wrzProgramConfig config = wrzLoadProgramConfig(CONFIGPATH);
+
+    FILE * list = fopen(args->batch_path, "r");
+    if(list == NULL) {
+        printf("ERROR: BATCH: Could not open job file \"%s\"!\n", args->batch_path);
+        wrzDestroyProgramConfig(&config);
+        return 13;
+    }
+
+    wrzSoundLibrary library = { 0 };
+    wrzBatch batch = { 0 };
+    int capacity = 0;
+
+    char line[4096];
+    int line_no = 0;
+    while(fgets(line, sizeof(line), list) != NULL) {
+        line_no++;
+
+        char output_path[512], tempo_map[2048], beats_directory[512];
+        int subdivision = 1, primary = config.primary_beat_no, secondary = config.secondary_beat_no;
+        snprintf(beats_directory, sizeof(beats_directory), "%s", config.beats_directory);
+
+        if(line[0] == '#') continue;
+        int found = sscanf(line, "%511s %2047s %d %511s %d %d", output_path, tempo_map, &subdivision, beats_directory, &primary, &secondary);
+        if(found <= 0) continue; // blank line
+
+        wrzBatchJob job = { 0 };
+        if(found < 2 || subdivision < 1 || subdivision > WRZ_MAX_SUBDIVISION || !wrzParseTempoMap(tempo_map, &job.tempo_map, &job.segment_count)) {
+            printf("WARNING: BATCH: Skipping line %d of \"%s\", it should be `OUTPUT BEATS@BPM[,BEATS@BPM...] [SUBDIVISION [BEATSDIR [PRIMARY [SECONDARY]]]]`.\n", line_no, args->batch_path);
+            continue;
+        }
+
+        // wrzLoadBeatSounds() exits on a missing directory, which would take every other track down with this one
+        if(!DirectoryExists(beats_directory)) {
+            printf("WARNING: BATCH: Beats directory \"%s\" on line %d does not exist, skipping it.\n", beats_directory, line_no);
+            free(job.tempo_map);
+            continue;
+        }
+
+        job.output_path = strdup(output_path);
+        job.subdivision = subdivision;
+        job.sounds = wrzGetBeatSounds(&library, beats_directory);
+        job.beat_idx = (primary >= 1 && primary <= job.sounds->count) ? primary - 1 : 0;
+        job.sub_beat_idx = (secondary >= 1 && secondary <= job.sounds->count) ? secondary - 1 : 0;
+
+        if(batch.job_count == capacity) {
+            capacity = (capacity > 0) ? capacity * 2 : 16;
+            batch.jobs = realloc(batch.jobs, capacity * sizeof(wrzBatchJob));
+        }
+        batch.jobs[batch.job_count++] = job;
+    }
+    fclose(list);
+
+    if(batch.job_count == 0) {
+        printf("ERROR: BATCH: No tracks to render in \"%s\"!\n", args->batch_path);
+        wrzDestroySoundLibrary(&library);
+        wrzDestroyProgramConfig(&config);
+        return 13;
+    }
+
+    //------------------------------------------------------------------------------
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int worker_count = (args->workers > 0) ? args->workers : (cpus > 0 ? (int) cpus : 1);
+    if(worker_count > WRZ_SERVER_WORKERS) worker_count = WRZ_SERVER_WORKERS;
+    if(worker_count > batch.job_count) worker_count = batch.job_count;
+
+    printf("INFO: BATCH: Rendering %d tracks with %d sound sets on %d workers.\n", batch.job_count, library.count, worker_count);
+
+    double start = wrzNow();
+
+    pthread_t workers[WRZ_SERVER_WORKERS];
+    for(int w = 0; w < worker_count; w++) pthread_create(&workers[w], NULL, wrzBatchWorkerThread, &batch);
+    for(int w = 0; w < worker_count; w++) pthread_join(workers[w], NULL);
+
+    double elapsed = wrzNow() - start;
+    double seconds = (double) atomic_load(&batch.frames_rendered) / WRZ_SAMPLE_RATE;
+    int failed = atomic_load(&batch.failed);
+
+    printf("INFO: BATCH: Rendered %d of %d tracks, %.1f min of audio in %.2f s, %.0fx real time.\n",
+        batch.job_count - failed, batch.job_count, seconds / 60.0, elapsed, (elapsed > 0.0) ? seconds / elapsed : 0.0);
+
+    for(int j = 0; j < batch.job_count; j++) {
+        free(batch.jobs[j].output_path);
+        free(batch.jobs[j].tempo_map);
+    }
+    free(batch.jobs);
+    wrzDestroySoundLibrary(&library);
+    wrzDestroyProgramConfig(&config);
+
+    return (failed > 0) ? 13 : 0;
+#else
+    printf("ERROR: BATCH: --batch is not supported on this platform yet.\n");
+    return 13;
+#endif
+}
+
+// --stress: render the clicks at extreme and fractional tempos with every subdivision and check that every one lands where it should
+// the sounds are single-frame impulses (1.0 for beats, 0.5 for sub-beats) with no onset, so the output says exactly when and which
+int wrzStressMain(void) {
+    const double tempos[] = { WRZ_MAX_BPM, 999.999, 123.456, 60.0, 1.5 };
+    const int subdivisions[] = { 1, 7, WRZ_MAX_SUBDIVISION };
+
+    float impulses[2] = { 1.0f, 0.5f };
+    wrzBeatSample samples[2] = { { &impulses[0], 1, 0 }, { &impulses[1], 1, 0 } };
+    wrzBeatSounds sounds = { samples, 2, impulses, 0 };
+
+    float * out = malloc(WRZ_STRESS_MAX_BLOCK * 2 * sizeof(float));
+    wrzCountAllocations(&wrz_counters.audio.allocations); // this thread stands in for the audio thread from here on, see wrzRenderClicks() below
+    srand(37); // the same block sizes every run, so a failure can be reproduced
+
+    int failures = 0;
+
+    for(int t = 0; t < (int) (sizeof(tempos) / sizeof(tempos[0])); t++) {
+        for(int d = 0; d < (int) (sizeof(subdivisions) / sizeof(subdivisions[0])); d++) {
+            double bpm = tempos[t];
+            int subdivision = subdivisions[d];
+
+            wrzClickEngine engine;
+            wrzInitClickEngine(&engine, &sounds, 0, 1);
+            engine.click_offset = NULL;
+            atomic_store(&engine.bpm, bpm);
+            atomic_store(&engine.subdivision, subdivision);
+
+            double spacing = (60.0 * WRZ_SAMPLE_RATE) / (bpm * subdivision); // the ideal frames between clicks
+            unsigned long long total = (unsigned long long) (fmax(WRZ_STRESS_SECONDS, 8.0 * 60.0 / bpm) * WRZ_SAMPLE_RATE); // at least a few beats at the slowest tempos
+
+            long long clicks = 0, misplaced = 0, wrong_sound = 0, allocating = 0;
+            double worst = 0.0;
+
+            for(unsigned long long rendered = 0; rendered < total;) {
+                unsigned int frames = 1 + rand() % WRZ_STRESS_MAX_BLOCK;
+                if(frames > total - rendered) frames = (unsigned int) (total - rendered);
+
+                long long allocations = atomic_load(&wrz_counters.audio.allocations);
+                wrzRenderClicks(&engine, out, frames);
+                if(atomic_load(&wrz_counters.audio.allocations) != allocations) allocating++; // the audio thread can't wait on the heap
+
+                for(unsigned int i = 0; i < frames; i++) {
+                    if(out[i * 2] == 0.0f) continue;
+
+                    double error = fabs((double) (rendered + i) - clicks * spacing);
+                    if(error > worst) worst = error;
+                    if(error > 0.501) misplaced++; // rounding to the nearest frame is all the error there should be, plus what adding up the spacing click by click drifts
+
+                    if(out[i * 2] != ((clicks % subdivision == 0) ? 1.0f : 0.5f)) wrong_sound++;
+                    clicks++;
+                }
+
+                rendered += frames;
+            }
+
+            long long expected = (long long) ceil((total - 0.5) / spacing); // every click whose onset rounds to a frame before the end
+            bool passed = clicks == expected && misplaced == 0 && wrong_sound == 0 && allocating == 0;
+            if(!passed) failures++;
+
+            printf("%s: STRESS: %8.3f bpm / %2d: %lld of %lld clicks, worst %.3f frames off, %lld misplaced, %lld wrong sound, %lld allocating blocks.\n",
+                passed ? "INFO" : "ERROR", bpm, subdivision, clicks, expected, worst, misplaced, wrong_sound, allocating);
+        }
+    }
+
+    free(out);
+
+    wrzCountAllocations(NULL);
+
+    if(failures > 0) printf("ERROR: STRESS: %d cases failed.\n", failures);
+    else printf("INFO: STRESS: Every case passed.\n");
+
+    if(!WRZ_COUNTS_ALLOCATIONS) printf("INFO: STRESS: Allocations are only checked in a `make build TRACK_ALLOCS=1` build.\n");
+
+    return (failures > 0) ? 7 : 0;
+}
@@ -0,0 +1,571 @@
+// midi out and .mid export, network tempo sync, and tap tempo: everything besides the sound card that the metronome talks to
+#include "metronome.h"
+
+#ifdef WRZ_ALSA_SEQ
+void wrzScheduleMidiEvent(wrzMidiOutput * m, snd_seq_event_t * ev, double time) {
+    double at = time - m->epoch;
+    if(at < 0.0) at = 0.0; // already late, the sequencer sends it right away
+
+    snd_seq_real_time_t when = { (unsigned int) at, (unsigned int) ((at - floor(at)) * 1e9) };
+
+    snd_seq_ev_set_source(ev, m->port);
+    snd_seq_ev_set_subs(ev);
+    snd_seq_ev_schedule_real(ev, m->seq_queue, 0, &when);
+    snd_seq_event_output(m->seq, ev);
+}
+
+// moves events from the engine's queue onto the sequencer's, which then sends each one at its own time
+// so the midi timing does not depend on how often this thread (or the gui) gets to run
+void * wrzMidiThread(void * data) {
+    wrzMidiOutput * m = (wrzMidiOutput *) data;
+    wrzTraceThread("midi");
+
+    while(atomic_load(&m->running)) {
+        long long head = atomic_load_explicit(&m->queue.head, memory_order_acquire);
+        long long tail = atomic_load_explicit(&m->queue.tail, memory_order_relaxed);
+
+        for(; tail < head; tail++) {
+            wrzMidiEvent * event = &m->queue.events[tail % WRZ_MIDI_QUEUE];
+            snd_seq_event_t ev;
+            snd_seq_ev_clear(&ev);
+
+            if(event->type == WRZ_MIDI_CLOCK) {
+                ev.type = SND_SEQ_EVENT_CLOCK;
+                wrzScheduleMidiEvent(m, &ev, event->time);
+            } else {
+                int note = (event->type == WRZ_MIDI_BEAT) ? WRZ_MIDI_BEAT_NOTE : WRZ_MIDI_SUB_BEAT_NOTE;
+
+                snd_seq_ev_set_noteon(&ev, WRZ_MIDI_CHANNEL, note, (event->type == WRZ_MIDI_BEAT) ? 110 : 80);
+                wrzScheduleMidiEvent(m, &ev, event->time);
+
+                snd_seq_ev_clear(&ev);
+                snd_seq_ev_set_noteoff(&ev, WRZ_MIDI_CHANNEL, note, 0);
+                wrzScheduleMidiEvent(m, &ev, event->time + 0.010);
+            }
+        }
+
+        atomic_store_explicit(&m->queue.tail, tail, memory_order_release);
+        snd_seq_drain_output(m->seq);
+
+        // events reach the queue about one audio buffer before they are due, so this only needs to beat the buffer
+        struct timespec nap = { 0, 1000000 };
+        nanosleep(&nap, NULL);
+    }
+
+    return NULL;
+}
+#endif
+
+// opens an alsa sequencer port called "WRZ Metronome:clock", anything subscribed to it gets the clock and a note per click
+bool wrzOpenMidiOutput(wrzMidiOutput * m) {
+    memset(m, 0, sizeof(wrzMidiOutput));
+
+#ifdef WRZ_ALSA_SEQ
+    if(snd_seq_open(&m->seq, "default", SND_SEQ_OPEN_OUTPUT, 0) < 0) {
+        printf("WARNING: MIDI: Could not open the alsa sequencer, carrying on without midi.\n");
+        return false;
+    }
+
+    snd_seq_set_client_name(m->seq, "WRZ Metronome");
+    m->port = snd_seq_create_simple_port(m->seq, "clock", SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ, SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    m->seq_queue = snd_seq_alloc_named_queue(m->seq, "wrz");
+
+    snd_seq_start_queue(m->seq, m->seq_queue, NULL);
+    snd_seq_drain_output(m->seq);
+    m->epoch = wrzNow();
+
+    snd_seq_event_t ev; // tell whoever is following that the clock is about to start
+    snd_seq_ev_clear(&ev);
+    ev.type = SND_SEQ_EVENT_START;
+    wrzScheduleMidiEvent(m, &ev, m->epoch);
+    snd_seq_drain_output(m->seq);
+
+    atomic_store(&m->running, 1);
+    pthread_create(&m->thread, NULL, wrzMidiThread, m);
+
+    printf("INFO: MIDI: Sending clock and notes from sequencer port %d:%d.\n", snd_seq_client_id(m->seq), m->port);
+    return true;
+#else
+    printf("WARNING: MIDI: This build has no midi support, rebuild with `make build MIDI=1`.\n");
+    return false;
+#endif
+}
+
+void wrzCloseMidiOutput(wrzMidiOutput * m) {
+#ifdef WRZ_ALSA_SEQ
+    if(!atomic_load(&m->running)) return;
+
+    atomic_store(&m->running, 0);
+    pthread_join(m->thread, NULL);
+
+    snd_seq_event_t ev;
+    snd_seq_ev_clear(&ev);
+    ev.type = SND_SEQ_EVENT_STOP;
+    snd_seq_ev_set_source(&ev, m->port);
+    snd_seq_ev_set_subs(&ev);
+    snd_seq_ev_set_direct(&ev);
+    snd_seq_event_output(m->seq, &ev);
+    snd_seq_drain_output(m->seq);
+
+    snd_seq_free_queue(m->seq, m->seq_queue);
+    snd_seq_close(m->seq);
+#else
+    (void) m;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void wrzWriteBigEndian(unsigned char ** cursor, unsigned int value, int bytes) {
+    for(int i = bytes - 1; i >= 0; i--) *(*cursor)++ = (value >> (8 * i)) & 0xFF;
+}
+
+void wrzWriteLittleEndian(unsigned char ** cursor, unsigned int value, int bytes) {
+    for(int i = 0; i < bytes; i++) *(*cursor)++ = (value >> (8 * i)) & 0xFF;
+}
+
+void wrzWriteVariableLength(unsigned char ** cursor, unsigned int value) { // midi's 7 bits per byte, most significant first
+    unsigned char bytes[5];
+    int count = 0;
+
+    do { bytes[count++] = value & 0x7F; value >>= 7; } while(value > 0);
+    while(count > 1) *(*cursor)++ = bytes[--count] | 0x80; // every byte but the last has the continuation bit set
+    *(*cursor)++ = bytes[0];
+}
+
+// saves WRZ_MIDI_FILE_BEATS beats of the current tempo and subdivision as a standard midi file, same notes as the live midi output
+bool wrzExportMidiFile(const char * path, double bpm, int subdivision) {
+    if(bpm < 1.0 || subdivision < 1) return false;
+
+    int clicks = WRZ_MIDI_FILE_BEATS * subdivision;
+    unsigned char * track = malloc(64 + clicks * 16); // a tempo, a name, an end, and two events of at most 8 bytes per click
+    unsigned char * cursor = track;
+
+    // tempo map: just the one tempo, in microseconds per beat
+    wrzWriteVariableLength(&cursor, 0);
+    *cursor++ = 0xFF; *cursor++ = 0x51; *cursor++ = 0x03;
+    wrzWriteBigEndian(&cursor, (unsigned int) llround(60000000.0 / bpm), 3);
+
+    const char * name = "WRZ Metronome";
+    wrzWriteVariableLength(&cursor, 0);
+    *cursor++ = 0xFF; *cursor++ = 0x03; *cursor++ = (unsigned char) strlen(name);
+    memcpy(cursor, name, strlen(name));
+    cursor += strlen(name);
+
+    long long previous = 0; // tick of the previous event, midi times are deltas
+    for(int n = 0; n < clicks; n++) {
+        long long on = llround((double) n * WRZ_MIDI_FILE_PPQN / subdivision);
+        long long off = on + ((WRZ_MIDI_FILE_PPQN / subdivision) / 2 > 0 ? (WRZ_MIDI_FILE_PPQN / subdivision) / 2 : 1);
+        int note = (n % subdivision == 0) ? WRZ_MIDI_BEAT_NOTE : WRZ_MIDI_SUB_BEAT_NOTE;
+
+        wrzWriteVariableLength(&cursor, (unsigned int) (on - previous));
+        *cursor++ = 0x90 | WRZ_MIDI_CHANNEL; *cursor++ = note; *cursor++ = (n % subdivision == 0) ? 110 : 80;
+
+        wrzWriteVariableLength(&cursor, (unsigned int) (off - on));
+        *cursor++ = 0x80 | WRZ_MIDI_CHANNEL; *cursor++ = note; *cursor++ = 0;
+
+        previous = off;
+    }
+
+    long long end = llround((double) clicks * WRZ_MIDI_FILE_PPQN / subdivision); // end of track on the beat after the last click
+    wrzWriteVariableLength(&cursor, (unsigned int) (end - previous));
+    *cursor++ = 0xFF; *cursor++ = 0x2F; *cursor++ = 0x00;
+
+    //------------------------------------------------------------------------------
+
+    FILE * f = fopen(path, "wb");
+    if(f == NULL) {
+        printf("WARNING: MIDI: Could not open \"%s\" for writing.\n", path);
+        free(track);
+        return false;
+    }
+
+    unsigned char header[22];
+    unsigned char * h = header;
+    memcpy(h, "MThd", 4); h += 4;
+    wrzWriteBigEndian(&h, 6, 4);
+    wrzWriteBigEndian(&h, 0, 2); // format 0, a single track
+    wrzWriteBigEndian(&h, 1, 2);
+    wrzWriteBigEndian(&h, WRZ_MIDI_FILE_PPQN, 2);
+    memcpy(h, "MTrk", 4); h += 4;
+    wrzWriteBigEndian(&h, (unsigned int) (cursor - track), 4);
+
+    fwrite(header, 1, sizeof(header), f);
+    fwrite(track, 1, cursor - track, f);
+    fclose(f);
+    free(track);
+
+    printf("INFO: MIDI: Exported %d beats at %.3f bpm, subdivision %d, to \"%s\".\n", WRZ_MIDI_FILE_BEATS, bpm, subdivision, path);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// osc strings are nul terminated and then padded out to a multiple of 4 bytes
+void wrzWriteOscString(unsigned char ** cursor, const char * text) {
+    size_t length = strlen(text) + 1;
+    size_t padded = (length + 3) & ~(size_t) 3;
+
+    memset(*cursor, 0, padded);
+    memcpy(*cursor, text, length);
+    *cursor += padded;
+}
+
+unsigned long long wrzReadBigEndian(const unsigned char ** cursor, int bytes) {
+    unsigned long long value = 0;
+    for(int i = 0; i < bytes; i++) value = (value << 8) | *(*cursor)++;
+    return value;
+}
+
+// the address and type tags every clock packet starts with, the arguments are the beat position, bpm, subdivision and a sequence number
+int wrzWriteSyncHeader(unsigned char * packet) {
+    unsigned char * cursor = packet;
+    wrzWriteOscString(&cursor, "/wrz/clock");
+    wrzWriteOscString(&cursor, ",ddii");
+    return (int) (cursor - packet);
+}
+
+void wrzWriteSyncPacket(unsigned char * packet, double beat, double bpm, int subdivision, int sequence) {
+    unsigned char * cursor = packet + wrzWriteSyncHeader(packet);
+
+    unsigned long long beat_bits, bpm_bits;
+    memcpy(&beat_bits, &beat, sizeof(beat_bits));
+    memcpy(&bpm_bits, &bpm, sizeof(bpm_bits));
+
+    wrzWriteBigEndian(&cursor, (unsigned int) (beat_bits >> 32), 4);
+    wrzWriteBigEndian(&cursor, (unsigned int) beat_bits, 4);
+    wrzWriteBigEndian(&cursor, (unsigned int) (bpm_bits >> 32), 4);
+    wrzWriteBigEndian(&cursor, (unsigned int) bpm_bits, 4);
+    wrzWriteBigEndian(&cursor, (unsigned int) subdivision, 4);
+    wrzWriteBigEndian(&cursor, (unsigned int) sequence, 4);
+}
+
+// returns false if the packet isn't a clock packet
+bool wrzReadSyncPacket(const unsigned char * packet, int length, double * beat, double * bpm, int * subdivision, int * sequence) {
+    unsigned char header[WRZ_SYNC_PACKET];
+    int header_length = wrzWriteSyncHeader(header);
+    if(length != WRZ_SYNC_PACKET || memcmp(packet, header, header_length) != 0) return false;
+
+    const unsigned char * cursor = packet + header_length;
+    unsigned long long beat_bits = wrzReadBigEndian(&cursor, 8);
+    unsigned long long bpm_bits = wrzReadBigEndian(&cursor, 8);
+    memcpy(beat, &beat_bits, sizeof(*beat));
+    memcpy(bpm, &bpm_bits, sizeof(*bpm));
+    *subdivision = (int) wrzReadBigEndian(&cursor, 4);
+    *sequence = (int) wrzReadBigEndian(&cursor, 4);
+
+    return true;
+}
+
+#ifndef _WIN32
+// sends where the leader's beat is every WRZ_SYNC_INTERVAL, the followers keep time on their own in between
+// the position is in beats rather than a time, so nobody's clock has to agree with anybody else's
+void * wrzSyncLeaderThread(void * data) {
+    wrzSync * s = (wrzSync *) data;
+    wrzTraceThread("sync");
+
+    int sequence = 0;
+    unsigned char packet[WRZ_SYNC_PACKET];
+
+    while(atomic_load(&s->running)) {
+        double beat = wrzBeatPositionAt(s->engine, wrzNow());
+
+        if(!isnan(beat)) {
+            wrzWriteSyncPacket(packet, beat, atomic_load(&s->engine->bpm), atomic_load(&s->engine->subdivision), sequence++);
+            sendto(s->socket, packet, sizeof(packet), 0, (struct sockaddr *) &s->address, sizeof(s->address));
+            atomic_fetch_add(&wrz_counters.sync.packets, 1);
+        }
+
+        struct timespec nap = { 0, (long) (WRZ_SYNC_INTERVAL * 1e9) };
+        nanosleep(&nap, NULL);
+    }
+
+    return NULL;
+}
+
+// a phase-locked loop: every packet says where the leader's beat is, and the engine's tempo is nudged by a little
+// in proportion to how far off ours is, and how far off it has been over time. packet jitter averages out over the
+// loop's time constant instead of ending up in the clicks
+void * wrzSyncFollowerThread(void * data) {
+    wrzSync * s = (wrzSync *) data;
+    wrzTraceThread("sync");
+
+    unsigned char packet[WRZ_SYNC_PACKET + 1]; // one spare byte, so a longer packet doesn't pass for a clock packet
+
+    while(atomic_load(&s->running)) {
+        ssize_t length = recv(s->socket, packet, sizeof(packet), 0); // times out now and then, so `running` gets checked
+        double now = wrzNow(); // on a lan the packet took a few tens of microseconds to get here, close enough to call it zero
+
+        double beat;
+        double bpm;
+        int subdivision, sequence;
+        if(length <= 0 || !wrzReadSyncPacket(packet, (int) length, &beat, &bpm, &subdivision, &sequence)) continue;
+        if(atomic_load(&s->have_leader) && sequence - s->last_sequence <= 0) continue; // arrived out of order, a newer one was already used
+        if(bpm < 1.0 || subdivision < 1) continue;
+
+        atomic_fetch_add(&wrz_counters.sync.packets, 1);
+        wrzTraceInstant("sync packet", "sequence", sequence);
+
+        if(!atomic_load(&s->have_leader)) printf("INFO: SYNC: Following a leader at %.3f bpm.\n", bpm);
+
+        // same tempo as the leader, the gui picks it up from here. our beat position is only comparable to the leader's once
+        // the engine has rendered at the new tempo, so the packet after a tempo change is the first one that counts
+        bool tempo_changed = !atomic_load(&s->have_leader) || bpm != atomic_load(&s->bpm) || subdivision != atomic_load(&s->subdivision);
+        atomic_store(&s->bpm, bpm);
+        atomic_store(&s->subdivision, subdivision);
+        atomic_store(&s->engine->bpm, bpm);
+        atomic_store(&s->engine->subdivision, subdivision);
+        atomic_store(&s->have_leader, 1);
+
+        s->last_sequence = sequence;
+        if(tempo_changed) continue;
+
+        double local = wrzBeatPositionAt(s->engine, now);
+        if(isnan(local)) continue;
+
+        // only the phase matters, the beat numbers themselves never match between instances
+        double error_beats = beat - local;
+        error_beats -= round(error_beats);
+        double error = error_beats * 60.0 / bpm; // seconds, positive if we are behind
+
+        if(!s->locked || fabs(error) > WRZ_SYNC_JUMP) {
+            atomic_store(&s->engine->phase_jump, error_beats);
+            atomic_store(&s->engine->tempo_scale, 1.0);
+            s->integral = 0.0;
+            if(s->locked) printf("INFO: SYNC: Out of phase by %.1f ms, jumping back into it.\n", error * 1000.0); // after the leader changes subdivision, or a hiccup
+            s->locked = true;
+        } else {
+            s->integral += error * (now - s->last_packet_time);
+            s->integral = Clamp(s->integral, -WRZ_SYNC_MAX_SKEW / WRZ_SYNC_KI, WRZ_SYNC_MAX_SKEW / WRZ_SYNC_KI); // so it can't wind up past what it is allowed to do
+
+            double scale = 1.0 + WRZ_SYNC_KP * error + WRZ_SYNC_KI * s->integral;
+            atomic_store(&s->engine->tempo_scale, Clamp(scale, 1.0 - WRZ_SYNC_MAX_SKEW, 1.0 + WRZ_SYNC_MAX_SKEW));
+        }
+
+        wrzRecordStat(&wrz_counters.sync.phase_error, error * 1000.0);
+        s->last_packet_time = now;
+    }
+
+    return NULL;
+}
+#endif
+
+// `address` is "HOST:PORT", where the leader sends to and where the followers listen, a multicast group like 239.255.0.77 reaches
+// every follower on the network (or on this machine) at once. followers take their tempo from the leader and ignore the gui's
+bool wrzOpenSync(wrzSync * s, wrzClickEngine * engine, const char * address, bool leading) {
+    memset(s, 0, sizeof(wrzSync));
+    s->engine = engine;
+    s->leading = leading;
+
+#ifndef _WIN32
+    char host[64];
+    int port;
+    if(sscanf(address, "%63[^:]:%d", host, &port) != 2 || port <= 0 || port > 65535) {
+        printf("WARNING: SYNC: \"%s\" is not a HOST:PORT address, carrying on without sync.\n", address);
+        return false;
+    }
+
+    s->address.sin_family = AF_INET;
+    s->address.sin_port = htons((unsigned short) port);
+    if(inet_pton(AF_INET, host, &s->address.sin_addr) != 1) {
+        printf("WARNING: SYNC: \"%s\" is not an ipv4 address, carrying on without sync.\n", host);
+        return false;
+    }
+
+    s->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if(s->socket < 0) {
+        printf("WARNING: SYNC: Could not open a udp socket, carrying on without sync.\n");
+        return false;
+    }
+
+    bool multicast = IN_MULTICAST(ntohl(s->address.sin_addr.s_addr));
+    int yes = 1;
+
+    if(leading) {
+        unsigned char ttl = 1; // stay on the local network
+        setsockopt(s->socket, SOL_SOCKET, SO_BROADCAST, &yes, sizeof(yes));
+        if(multicast) setsockopt(s->socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    } else {
+        setsockopt(s->socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)); // several followers on one machine can share the port
+
+        struct sockaddr_in any = { 0 };
+        any.sin_family = AF_INET;
+        any.sin_port = s->address.sin_port;
+        any.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        if(bind(s->socket, (struct sockaddr *) &any, sizeof(any)) != 0) {
+            printf("WARNING: SYNC: Could not listen on port %d, carrying on without sync.\n", port);
+            close(s->socket);
+            return false;
+        }
+
+        if(multicast) {
+            struct ip_mreq group = { 0 };
+            group.imr_multiaddr = s->address.sin_addr;
+            group.imr_interface.s_addr = htonl(INADDR_ANY);
+            setsockopt(s->socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group));
+        }
+
+        struct timeval timeout = { 0, 200000 };
+        setsockopt(s->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    atomic_store(&s->running, 1);
+    pthread_create(&s->thread, NULL, leading ? wrzSyncLeaderThread : wrzSyncFollowerThread, s);
+
+    printf("INFO: SYNC: %s the beat on %s:%d.\n", leading ? "Sending" : "Following", host, port);
+    return true;
+#else
+    printf("WARNING: SYNC: Network sync is not supported on this platform yet.\n");
+    return false;
+#endif
+}
+
+void wrzCloseSync(wrzSync * s) {
+#ifndef _WIN32
+    if(!atomic_load(&s->running)) return;
+
+    atomic_store(&s->running, 0);
+    pthread_join(s->thread, NULL);
+    close(s->socket);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+// fits a straight line through the taps, time against beat number, so one sloppy tap only moves the tempo by a fraction of how far off it was
+void wrzFitTapTempo(wrzTapTempo * t) {
+    int n = (t->count < WRZ_TAP_WINDOW) ? t->count : WRZ_TAP_WINDOW;
+    int newest = (t->count - 1) % WRZ_TAP_WINDOW;
+
+    // everything relative to the newest tap, so the sums don't lose precision
+    double mean_beat = 0.0, mean_time = 0.0;
+    for(int i = 0; i < n; i++) {
+        mean_beat += (double) (t->beats[i] - t->beats[newest]);
+        mean_time += t->times[i] - t->times[newest];
+    }
+    mean_beat /= n;
+    mean_time /= n;
+
+    double covariance = 0.0, variance = 0.0;
+    for(int i = 0; i < n; i++) {
+        double beat = (double) (t->beats[i] - t->beats[newest]) - mean_beat;
+        covariance += beat * (t->times[i] - t->times[newest] - mean_time);
+        variance += beat * beat;
+    }
+
+    t->period = covariance / variance;
+    t->phase = t->times[newest] + mean_time - t->period * mean_beat; // where the line puts the newest beat
+}
+
+// returns true if there is a new tempo in t->period and t->phase
+// taps that come too soon after the last one (a bounce or a flam) are dropped, a skipped beat is fine, and anything else that
+// doesn't fit the tempo so far starts a new run from the tap before it
+bool wrzTap(wrzTapTempo * t, double time) {
+    long long beat = 0;
+
+    if(t->count > 0) {
+        int newest = (t->count - 1) % WRZ_TAP_WINDOW;
+        double gap = time - t->times[newest];
+
+        if(gap <= 0.0) return false; // out of order, one source's taps reached us later than the other's
+        if(gap > WRZ_TAP_TIMEOUT) t->count = 0;
+        else if(t->count < 2) beat = t->beats[newest] + 1;
+        else {
+            double beats = gap / t->period;
+            if(beats < 0.5) return false;
+
+            if(fabs(beats - round(beats)) > WRZ_TAP_TOLERANCE || beats > 2.5) {
+                t->times[0] = t->times[newest];
+                t->beats[0] = 0;
+                t->count = 1;
+                beat = 1;
+            } else beat = t->beats[newest] + llround(beats);
+        }
+    }
+
+    t->times[t->count % WRZ_TAP_WINDOW] = time;
+    t->beats[t->count % WRZ_TAP_WINDOW] = beat;
+    t->count++;
+
+    if(t->count < 2) return false;
+
+    wrzFitTapTempo(t);
+    return true;
+}
+
+bool wrzPopTap(wrzTapInput * in, double * time) {
+    long long tail = atomic_load_explicit(&in->tail, memory_order_relaxed);
+    if(tail == atomic_load_explicit(&in->head, memory_order_acquire)) return false;
+
+    *time = in->times[tail % WRZ_TAP_QUEUE];
+    atomic_store_explicit(&in->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+#ifdef __linux__
+typedef struct {
+    struct timeval time;
+    unsigned short type, code;
+    int value;
+} wrzInputEvent; // struct input_event from <linux/input.h>, which can't be included next to raylib.h since both define KEY_SPACE and friends
+
+#define WRZ_EV_KEY 1
+#define WRZ_EVIOCSCLOCKID _IOW('E', 0xa0, int)
+
+void * wrzTapInputThread(void * data) {
+    wrzTapInput * in = (wrzTapInput *) data;
+    wrzInputEvent ev;
+
+    while(atomic_load(&in->running)) {
+        struct pollfd device = { in->device, POLLIN, 0 };
+        if(poll(&device, 1, 200) <= 0) continue; // times out now and then, so `running` gets checked
+        if(read(in->device, &ev, sizeof(ev)) != sizeof(ev)) continue;
+        if(ev.type != WRZ_EV_KEY || ev.value != 1) continue; // only presses, not releases or key repeats
+
+        long long head = atomic_load_explicit(&in->head, memory_order_relaxed);
+        if(head - atomic_load_explicit(&in->tail, memory_order_acquire) >= WRZ_TAP_QUEUE) continue;
+
+        in->times[head % WRZ_TAP_QUEUE] = in->kernel_time ? ev.time.tv_sec + ev.time.tv_usec / 1e6 : wrzNow();
+        atomic_store_explicit(&in->head, head + 1, memory_order_release);
+    }
+
+    return NULL;
+}
+#endif
+
+// every key pressed on the evdev device at `path` (/dev/input/eventN, a foot pedal or a spare keypad) is a tap
+bool wrzOpenTapInput(wrzTapInput * in, const char * path) {
+    memset(in, 0, sizeof(wrzTapInput));
+
+#ifdef __linux__
+    in->device = open(path, O_RDONLY);
+    if(in->device < 0) {
+        printf("WARNING: TAP: Could not open \"%s\", are you in the `input` group? Carrying on without it.\n", path);
+        return false;
+    }
+
+    // the kernel stamps every event when the key actually went down, and on our clock if we ask it to
+    int clock_id = CLOCK_MONOTONIC;
+    in->kernel_time = ioctl(in->device, WRZ_EVIOCSCLOCKID, &clock_id) == 0;
+
+    atomic_store(&in->running, 1);
+    pthread_create(&in->thread, NULL, wrzTapInputThread, in);
+
+    printf("INFO: TAP: Taking taps from \"%s\"%s.\n", path, in->kernel_time ? "" : ", timed when read since it can't use the monotonic clock");
+    return true;
+#else
+    printf("WARNING: TAP: --tap-device is only supported on Linux.\n");
+    return false;
+#endif
+}
+
+void wrzCloseTapInput(wrzTapInput * in) {
+#ifdef __linux__
+    if(!atomic_load(&in->running)) return;
+
+    atomic_store(&in->running, 0);
+    pthread_join(in->thread, NULL);
+    close(in->device);
+#endif
+}
@@ -0,0 +1,768 @@
+// everything the parts of the metronome share: the build options, the limits, the types, and what each .c file gives the others
+#ifndef WRZ_METRONOME_H
+#define WRZ_METRONOME_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include <signal.h>
+
+#ifndef _WIN32 // real-time scheduling and memory locking, see wrzPrepareAudioThread()
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h> // network tempo sync, see wrzOpenSync()
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__ // --tap-device, see wrzOpenTapInput()
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#endif
+
+#ifdef WRZ_ALSA_SEQ // `make build MIDI=1`, midi clock out through the alsa sequencer, linux only
+#include <alsa/asoundlib.h>
+#endif
+
+#ifdef WRZ_JACK // `make linux JACK=1`, play as a jack client, see wrzOpenJackOutput()
+#include <jack/jack.h>
+#include <jack/transport.h>
+#endif
+
+#include <raylib.h>
+#include <raymath.h>
+
+// the click engine opens its own device so it can pick the buffer size and ask how much latency it actually got
+// raudio.c already compiles miniaudio into raylib, so only the header is needed here (use the copy from raylib's src/external/),
+// with the same options raudio.c builds it with so the structs line up
+#define MA_NO_JACK
+#define MA_NO_WAV
+#define MA_NO_FLAC
+#define MA_NO_MP3
+#define MA_NO_RESOURCE_MANAGER
+#define MA_NO_NODE_GRAPH
+#define MA_NO_ENGINE
+#define MA_NO_GENERATION
+#include "miniaudio.h"
+
+#define WIDTH 1200
+#define HEIGHT 900
+
+#define VERSIONNO "1.9"
+
+#define CONFIGPATH "./metronome.config"
+
+#define WRZ_MAX_BPM 1000.0 // fastest tempo the slider, the text box and tap tempo go up to
+#define WRZ_MAX_SUBDIVISION 16 // the subdivision button cycles from 1 up to this
+
+#define WRZ_SAMPLE_RATE 48000 // every beat sound is converted to this rate on load, and the click engine renders at it
+#define WRZ_JACK_CHUNK 256 // frames rendered at a time inside the jack process callback, which can ask for any number of them
+
+#define WRZ_STRESS_SECONDS 600.0 // how long every --stress case is rendered for, long enough for a tempo off in the 7th digit to show
+#define WRZ_STRESS_MAX_BLOCK 4096 // --stress renders in random block sizes up to this, like a sound card that can't make up its mind
+#define WRZ_ALLOC_WARMUP_FRAMES 120 // frames --alloc-audit lets the gui allocate in while raylib and the caches get going
+#define WRZ_MAX_VOICES 64 // how many clicks can ring at the same time before the oldest gets cut off, 1000 bpm in 16ths starts ~20 in one big block
+
+#define WRZ_TRIM_THRESHOLD 0.001f // -60 dB relative to the sample's peak, anything quieter at the edges counts as silence
+#define WRZ_ONSET_THRESHOLD 0.25f // -12 dB relative to the peak, where we consider the click to actually be "heard"
+#define WRZ_TRIM_PREROLL 16 // frames kept in front of the first non-silent frame so the attack isn't chopped
+#define WRZ_TRIM_FADE 96 // frames of linear fade-out applied to the trimmed tail (2 ms at 48 kHz) so it doesn't pop
+
+#define WRZ_CLICK_HISTORY 32 // how many of the most recent click onsets the engine remembers, for matching the visuals to what is being heard
+
+#define WRZ_RT_PRIORITY 70 // SCHED_FIFO priority asked for with REALTIME = 1, above the desktop but below the kernel's irq threads
+#define WRZ_STACK_PREFAULT (64 * 1024) // bytes of audio thread stack touched and locked before the first click is rendered
+
+#define WRZ_TRACE_EVENTS 65536 // events kept per thread by --trace, older ones get overwritten
+#define WRZ_TRACE_THREADS 8 // how many threads can record trace events
+
+#define WRZ_REPLAY_RING 4096 // blocks the audio thread can get ahead of the gui writing them to --record's log, ~20 s of 256-frame blocks
+#define WRZ_INPUT_KEYS 512 // raylib's MAX_KEYBOARD_KEYS, every key code is below it
+#define WRZ_INPUT_BUTTONS 7 // MOUSE_BUTTON_LEFT up to MOUSE_BUTTON_BACK
+#define WRZ_INPUT_CHARS 16 // characters typed in one frame that are kept, as many as raylib's own queue holds
+#define WRZ_INPUT_TAPS 16 // taps from --tap-device one frame takes, any more wait for the next
+
+#define WRZ_MIDI_QUEUE 1024 // midi events waiting to be handed to the sequencer, the audio thread drops them if it fills up
+#define WRZ_MIDI_PPQN 24 // midi clock ticks per beat, fixed by the midi spec
+#define WRZ_MIDI_CHANNEL 9 // 0-indexed, channel 10 is the general midi drum channel
+#define WRZ_MIDI_BEAT_NOTE 76 // general midi hi wood block
+#define WRZ_MIDI_SUB_BEAT_NOTE 77 // general midi low wood block
+#define WRZ_MIDI_FILE_PPQN 480 // ticks per beat in exported .mid files
+#define WRZ_MIDI_FILE_BEATS 32 // how many beats of the current pattern F2 exports
+
+#define WRZ_CALIBRATION_CLICKS 8 // how many clicks --calibrate plays through the loopback
+#define WRZ_CALIBRATION_WINDOW 0.25 // seconds after each click in which its echo has to show up in the capture
+
+#define WRZ_SYNC_INTERVAL 0.05 // seconds between the leader's clock packets
+#define WRZ_SYNC_PACKET 44 // bytes in one "/wrz/clock" osc message
+#define WRZ_SYNC_KP 1.0 // follower loop gain on the phase error, the error shrinks with a time constant of about 1 / WRZ_SYNC_KP seconds
+#define WRZ_SYNC_KI 0.1 // follower loop gain on the accumulated phase error, which is what soaks up two sound cards running at slightly different rates
+#define WRZ_SYNC_MAX_SKEW 0.01 // the follower never plays more than 1% faster or slower than the leader to catch up
+#define WRZ_SYNC_JUMP 0.020 // seconds of phase error past which the follower jumps straight into phase instead of catching up
+
+#define WRZ_SERVER_BLOCK 256 // frames every session renders per tick in --server mode, 5.3 ms at 48 kHz
+#define WRZ_SERVER_CHUNK 8 // sessions a worker takes at a time, so they don't all fight over the same counter
+#define WRZ_SERVER_WORKERS 64 // most worker threads --workers can ask for
+
+#define WRZ_STREAM_BLOCK 1024 // frames --stream renders and writes at a time, 21 ms at 48 kHz
+#define WRZ_STREAM_MAX_RATE 384000 // highest --rate, the output buffer is sized for it
+
+#define WRZ_TEMPO_BUTTONS 9 // most tempo buttons on either side, see left_side_numbers
+
+#define WRZ_LABEL_LENGTH 96 // longest text a wrzTextLabel holds, including the '\0'
+#define WRZ_PULSE_TRIANGLES 128 // enough for both pulses and a dot for every one of WRZ_MAX_SUBDIVISION sub-beats
+#define WRZ_DIGITS "0123456789." // every character wrzDrawBPM() can draw, see wrzLoadDigitFont()
+
+#define WRZ_RENDER_BLOCK 4096 // frames --render renders at a time
+#define WRZ_FLAC_BLOCK 4096 // frames in every flac frame, what the reference encoder uses at 48 kHz
+#define WRZ_FLAC_MAX_PARTITION_ORDER 8 // the residual is split into up to 2^this parts, each with its own rice parameter
+#define WRZ_FLAC_FRAME_BYTES (WRZ_FLAC_BLOCK * 2 * 5 + 64) // more than one verbatim frame, which is the most wrzFlacWriteFrame() will ever pick
+
+#define WRZ_TAP_WINDOW 8 // how many of the latest taps the tempo is fitted to
+#define WRZ_TAP_TIMEOUT 2.0 // seconds without a tap after which the next one starts over
+#define WRZ_TAP_TOLERANCE 0.25 // beats a tap can be off from where the tempo so far puts it before it counts as a new tempo
+#define WRZ_TAP_QUEUE 64 // taps from --tap-device waiting for the gui
+
+#define WRZ_TRACK_FFT 1024 // frames per spectrum the beat tracker looks at, 21 ms
+#define WRZ_TRACK_HOP 256 // frames between spectra, so the onset envelope runs at 187.5 Hz
+#define WRZ_TRACK_HISTORY 1024 // envelope values the tempo is estimated from, about 5.5 s
+#define WRZ_TRACK_RING 16384 // captured frames that can wait for the tracker, a power of two
+#define WRZ_TRACK_EVERY 64 // hops between tempo estimates, a third of a second
+#define WRZ_TRACK_MIN_BPM 50.0
+#define WRZ_TRACK_MAX_BPM 250.0
+#define WRZ_TRACK_SMOOTHING 0.3 // how much of each new estimate goes into the tempo, once it has settled
+#define WRZ_TRACK_PHASE_TOLERANCE 0.015 // seconds the clicks can be off the tracked beat before they are moved onto it
+
+//------------------------------------------------------------------------------
+
+typedef struct {
+    float * data; // mono, WRZ_SAMPLE_RATE, points into wrzBeatSounds.arena
+    int frame_count; // length after trimming
+    int onset_frames; // frames from the start of the trimmed sample to its onset, the scheduler starts the sample this early
+} wrzBeatSample;
+
+typedef struct {
+    wrzBeatSample * samples;
+    int count;
+    float * arena; // every sample's frames live in this one allocation
+    int max_onset_frames; // largest onset_frames of all the samples
+} wrzBeatSounds; // return type for wrzLoadBeatSounds()
+
+typedef struct {
+    int primary_beat_no, secondary_beat_no; // suffixed "no" because this data is 1-indexed
+    char * beats_directory;
+    char * style_filepath;
+    int audio_buffer_frames; // AUDIOBUFFER, frames per device period, 0 lets the backend decide
+    int audio_periods; // PERIODS, how many periods the device buffer is split into, 0 lets the backend decide
+    int realtime; // REALTIME, 1 to run the audio thread with real-time priority and keep its memory locked in ram
+    float output_latency_ms; // LATENCY, measured by --calibrate, negative if never calibrated
+    char * audio_backend; // AUDIOBACKEND, which audio api to play through, see wrzFindAudioBackend(), NULL for the first one that works
+} wrzProgramConfig;
+
+typedef struct {
+    bool calibrate; // --calibrate
+    int period_frames, periods; // --period-size N, --periods N, they override AUDIOBUFFER and PERIODS for this run only, -1 if not given
+    const char * audio_backend; // --audio-backend NAME, overrides AUDIOBACKEND for this run only
+    bool realtime; // --realtime, same as REALTIME = 1 for this run
+    bool stats; // --stats, start with the counters overlay shown
+    const char * stats_path; // --stats-json FILE, where the counters are dumped on exit and on SIGUSR1, NULL for stdout on SIGUSR1 only
+    const char * trace_path; // --trace FILE, record a timeline and save it there as chrome trace json on exit, NULL to not trace
+    bool midi; // --midi, send midi clock and notes out of an alsa sequencer port
+    const char * midi_export_path; // --export-midi FILE, where F2 saves the current pattern, "./metronome.mid" if not given
+    const char * sync_lead; // --sync-lead HOST:PORT, send our beat to other metronomes, NULL to not
+    const char * sync_follow; // --sync-follow HOST:PORT, take the beat from a leader, NULL to not
+    const char * server_path; // --server FILE, run every session listed in FILE without a window, NULL for the normal gui
+    bool jack; // --jack, play through jack as a client instead of through miniaudio
+    bool jack_transport; // --jack-transport, same as --jack but the tempo and the beat come from the jack transport
+    bool follow_input; // --follow-input, follow the beat of whatever the default input hears
+    const char * follow_file; // --follow-file FILE, follow the beat of FILE as if it were being heard, for trying it out
+    const char * tap_device; // --tap-device PATH, an evdev device whose every key press is a tap, NULL for only the button and T
+    int workers; // --workers N, threads --server renders with, 0 for one per cpu
+    double duration; // --duration SECONDS, how long --server runs for, 0 until it is interrupted, or the window stays open for, 0 until it is closed
+    bool stress; // --stress, check the click timing at extreme tempos and subdivisions without a window or sound card
+    bool alloc_audit; // --alloc-audit, exit with 9 if the gui or the audio thread allocated once they were running, needs a TRACK_ALLOCS build
+    const char * record_path; // --record FILE, log every block the engine renders and every frame the gui draws, for --replay
+    const char * replay_path; // --replay FILE, render a --record log again without a window or sound card and check the engine comes out the same
+    const char * stream_path; // --stream PATH, write raw pcm clicks to PATH (a file or named pipe) or "-" for stdout, NULL for the normal gui
+    double bpm; // --bpm N, tempo for --stream, 0 for 60
+    int subdivision; // --subdivision N, for --stream, 0 for 1
+    int rate; // --rate N, sample rate of the stream, 0 for WRZ_SAMPLE_RATE
+    const char * format; // --format s16|s24|s32|f32, sample format of the stream, NULL for s16
+    bool fast; // --fast, write the stream as fast as whatever reads it keeps up instead of in real time
+    const char * render_path; // --render FILE, render --duration seconds of --bpm and --subdivision into FILE (.flac or .wav) as fast as possible
+    const char * batch_path; // --batch FILE, render every track listed in FILE, on --workers threads
+} wrzCommandLine;
+
+typedef struct {
+    _Atomic long long count;
+    _Atomic double last, min, max, total; // milliseconds
+} wrzStat; // only ever written by one thread, so it can be read from any other without a lock
+
+typedef struct {
+    struct { // written by the gui thread
+        wrzStat frame_time; // from one frame to the next
+        wrzStat present_error; // when a frame actually went up minus when wrzPredictPresentTime() said it would
+        _Atomic long long allocations; // only counted in TRACK_ALLOCS builds, see __wrap_malloc()
+        _Atomic long long allocating_frames; // frames that allocated once the gui had warmed up, see wrzAuditFrameAllocations()
+    } gui;
+
+    struct { // written by the audio thread
+        wrzStat callback_time; // how long wrzAudioOutputCallback() took
+        wrzStat deadline_margin; // how much of the block's duration was left over after rendering it, negative means it was late
+        wrzStat click_offset; // where a click's onset actually landed minus where the grid wanted it
+        _Atomic long long underruns; // callbacks that came too late for the device buffer to have covered the gap
+        _Atomic long long allocations;
+        _Atomic long long allocating_callbacks; // callbacks that allocated at all, there is no warming up on the audio thread
+    } audio;
+
+    struct { // written by the network sync thread
+        wrzStat phase_error; // where the leader's beat was minus where ours was, each time a clock packet came in
+        _Atomic long long packets;
+    } sync;
+
+    struct { // written by the --server clock thread
+        wrzStat tick_time; // how long every session took to render one block, start to finish
+        _Atomic long long late_ticks; // ticks that started after they were due because the previous one ran over
+    } server;
+} wrzCounters;
+
+typedef struct {
+    const char * name; // must be a string literal, it is only read when the trace is saved
+    const char * arg_name; // NULL for no argument
+    char phase; // 'X' for a span, 'i' for an instant
+    double start, duration; // microseconds since tracing started
+    long long arg;
+} wrzTraceEvent;
+
+typedef struct {
+    const char * thread_name;
+    wrzTraceEvent * events; // ring of WRZ_TRACE_EVENTS
+    _Atomic long long written; // total events ever written, the newest is at (written - 1) % WRZ_TRACE_EVENTS
+} wrzTraceBuffer; // one per thread, so recording never has to wait on another thread
+
+typedef enum { WRZ_MIDI_CLOCK, WRZ_MIDI_BEAT, WRZ_MIDI_SUB_BEAT } wrzMidiEventType;
+
+typedef struct {
+    wrzMidiEventType type;
+    double time; // wrzNow() at which the event should be heard, so it lines up with the click
+} wrzMidiEvent;
+
+typedef struct {
+    wrzMidiEvent events[WRZ_MIDI_QUEUE];
+    _Atomic long long head, tail; // written by the audio thread and the midi thread respectively
+} wrzMidiQueue; // single producer, single consumer
+
+typedef struct {
+    unsigned int frames;
+    double block_time; // the engine's, at the start of the block
+    double bpm, tempo_scale, anchor, jump; // exactly what the engine read out of its atomics, the anchor and jump after being taken
+    int subdivision, beat_idx, sub_beat_idx;
+    long long gui_frame; // the engine's gui_frame while it read them, odd if the gui was in the middle of handing a frame's values over
+    unsigned long long hash; // of the rendered block, see wrzHashBytes()
+} wrzReplayBlock; // everything from outside the engine that went into one block, so it can be rendered again bit for bit
+
+typedef struct {
+    FILE * file; // the log, only ever written by the gui
+    wrzReplayBlock blocks[WRZ_REPLAY_RING];
+    _Atomic long long written, drained; // by the audio thread and the gui respectively
+    _Atomic int overflowed; // the gui fell too far behind, nothing is recorded from then on so the log is still a replayable prefix
+    long long frames_logged; // audio frames in the blocks written so far
+} wrzReplayRecorder; // --record, single producer, single consumer
+
+typedef struct {
+    double now; // wrzNow() as the frame started, taps from the button and T are timed with it
+    double present_time; // see wrzPredictPresentTime()
+    float frame_time; // GetFrameTime()
+    int width, height; // GetScreenWidth() and GetScreenHeight()
+    float dpi; // GetWindowScaleDPI().x
+    Vector2 mouse;
+    float wheel; // GetMouseWheelMove()
+    unsigned int buttons; // bit n is set while mouse button n is down
+    unsigned char keys[WRZ_INPUT_KEYS / 8]; // the same for every key code
+    int chars[WRZ_INPUT_CHARS]; // GetCharPressed(), in the order they were typed
+    int char_count, chars_taken; // how many there are, and how many raygui has asked for so far
+    double taps[WRZ_INPUT_TAPS]; // from --tap-device
+    int tap_count;
+
+    // what the other threads had to say, as of the start of the frame
+    long long tracker_estimates; // see wrzBeatTracker
+    double tracker_bpm, tracker_beat;
+    int have_leader, leader_subdivision; // see wrzSync
+    double leader_bpm;
+    int transport_rolling; // see wrzAudioOutput
+    double transport_bpm;
+    long long underruns;
+} wrzFrameInput; // everything a frame of the gui reads from outside itself, so --record can log it and --replay can hand it back
+
+typedef struct {
+    wrzFrameInput input;
+    long long clock; // first frame of the block the beat clock was read after, -1 if nothing had been rendered yet
+    unsigned long long hash; // of what the frame showed, see wrzHashFrame()
+} wrzReplayFrame; // one frame the gui drew, as --record logged it
+
+typedef struct {
+    wrzBeatSample * sample; // NULL if this voice is free
+    long long position; // frame of the sample to be mixed at the start of the next block, negative while waiting to start
+} wrzVoice;
+
+typedef struct {
+    _Atomic unsigned int sequence; // odd while the audio thread is in the middle of writing
+    _Atomic double grid_frame, beat; // onset frame of the last click, and how many beats in it was
+    _Atomic double beat_frames; // frames per beat at the current tempo
+    _Atomic unsigned long long clock; // first frame of the last block rendered
+    _Atomic double block_time; // wrzNow() at which `clock` is heard
+} wrzBeatClock; // a seqlock, so the values read always come from the same block, see wrzBeatPositionAt()
+
+typedef struct {
+    unsigned int sequence; // 0 if nothing has been rendered yet
+    double grid_frame, beat, beat_frames, block_time;
+    unsigned long long clock;
+} wrzBeatClockReading; // one consistent copy of a wrzBeatClock, see wrzReadBeatClock()
+
+typedef struct {
+    // written by the gui, read by the audio thread
+    _Atomic double bpm; // double, so a tempo like 123.456 doesn't drift against one computed elsewhere
+    _Atomic int subdivision;
+    _Atomic int beat_idx, sub_beat_idx; // 0-indexed into sounds->samples
+    _Atomic double phase_anchor; // wrzNow() at which a beat was heard (a tap), the grid is moved onto it at the next block, 0 for none
+    _Atomic long long gui_frame; // two per frame that has handed its values over, odd while one is in the middle of it, see wrzGuiFrameBegin()
+
+    // written by the network sync follower, read by the audio thread
+    _Atomic double tempo_scale; // 1.0 normally, nudged a little either way to pull the clicks into phase with the leader
+    _Atomic double phase_jump; // beats to move the grid ahead by at the start of the next block, 0 for none
+
+    // owned by the audio thread
+    wrzBeatSounds * sounds;
+    double last_grid_frame; // the frame the last click's onset was placed on
+    long long clicks_scheduled;
+    double beat_position; // beats since the first click up to the last one, sub-beats are fractions
+    int sub_play_counter; // counts how many times in a single beat the sound has been played, used for tracking which sound to play
+    wrzVoice voices[WRZ_MAX_VOICES];
+    wrzStat * click_offset; // where every click's timing error is recorded, NULL to not, only one engine per thread may share a stat
+
+    // midi, owned by the audio thread, only used if `midi` is set
+    wrzMidiQueue * midi; // where the clock ticks and notes go, NULL for no midi
+    double block_time; // wrzNow() at which the first frame of the block being rendered will be heard, set by whoever drives the engine
+    double tick_anchor, tick_spacing; // onset frame of the last beat, and frames per midi clock tick at that beat's tempo
+    int ticks_sent; // clock ticks sent since tick_anchor, WRZ_MIDI_PPQN once the beat is done
+
+    wrzReplayRecorder * recorder; // where every block's inputs go for --record, NULL to not
+
+    // written by the audio thread, read by the gui
+    _Atomic unsigned long long frame_clock; // frames rendered since the engine started
+    _Atomic unsigned long long click_history[WRZ_CLICK_HISTORY]; // onset frames of the most recent clicks, as a ring
+    _Atomic long long click_count; // how many clicks have been written to click_history
+    wrzBeatClock beat_clock;
+} wrzClickEngine;
+
+typedef struct {
+    wrzBeatSounds * sounds; // not owned, several sessions can play the same set
+    wrzClickEngine engine;
+    double bpm; // raygui sliders work in floats, wrzSpeedSelectionSlider() only converts when it is dragged, so typed-in tempos keep every digit
+    int subdivision; // denotes which fraction (1 / subdivision) of the beat we are using
+    int beat_idx, sub_beat_idx; // 0-indexed into sounds->samples
+
+    // only used by --server, see wrzServerMain()
+    char * output_path;
+    FILE * output; // 16-bit stereo wav, written one block at a time
+} wrzSession; // one metronome: what it plays and how fast, separate from however it is being shown or heard
+
+typedef struct {
+    ma_context context;
+    ma_device device;
+    wrzClickEngine * engine;
+    bool realtime;
+    unsigned int period_frames, periods; // what the backend actually gave us, not what we asked for
+    double latency; // seconds between a frame being rendered and it coming out of the speakers
+
+    // owned by the audio thread
+    double last_callback_time; // wrzNow() at the start of the previous callback, 0 before the first one
+    bool thread_prepared;
+
+    _Atomic int realtime_status; // 0 until the first callback, then 1 if the audio thread got real-time priority, -1 if it was refused
+
+    // only used as a jack client, see wrzOpenJackOutput()
+    bool jack; // true if this is a jack client instead of a miniaudio device
+#ifdef WRZ_JACK
+    jack_client_t * jack_client;
+    jack_port_t * jack_ports[2]; // left, right
+    float jack_scratch[WRZ_JACK_CHUNK * 2]; // wrzRenderClicks() writes interleaved stereo, jack wants a buffer per channel
+#endif
+    bool follow_transport; // --jack-transport, take the tempo and beat from the jack transport
+    bool transport_was_rolling; // owned by the audio thread, so it knows when the transport has just started
+    _Atomic int transport_rolling; // written by the audio thread, the gui shows the transport's tempo while it is
+    _Atomic double transport_bpm;
+} wrzAudioOutput;
+
+typedef struct {
+    wrzMidiQueue queue; // filled by the click engine
+#ifdef WRZ_ALSA_SEQ
+    snd_seq_t * seq;
+    int port, seq_queue;
+    double epoch; // wrzNow() when the sequencer queue was started, sequencer time 0
+    pthread_t thread;
+#endif
+    _Atomic int running;
+} wrzMidiOutput;
+
+typedef struct {
+    wrzClickEngine * engine;
+    bool leading; // true to send the clock, false to follow it
+#ifndef _WIN32
+    int socket;
+    struct sockaddr_in address; // where the leader sends to, usually a multicast group
+    pthread_t thread;
+#endif
+    _Atomic int running;
+
+    // owned by the follower thread
+    double integral; // phase error in seconds, summed over time
+    double last_packet_time;
+    int last_sequence;
+    bool locked; // false until the first jump into phase
+
+    // written by the follower thread, read by the gui
+    _Atomic double bpm;
+    _Atomic int subdivision;
+    _Atomic int have_leader; // 0 until the first packet arrives
+} wrzSync;
+
+typedef struct {
+    double times[WRZ_TAP_WINDOW]; // wrzNow() of each tap, as a ring
+    long long beats[WRZ_TAP_WINDOW]; // which beat of the run each tap was on, a skipped beat leaves a gap
+    int count; // taps in this run
+    double period, phase; // seconds per beat and when the newest tap's beat was, from the last fit
+} wrzTapTempo;
+
+typedef struct {
+    double times[WRZ_TAP_QUEUE];
+    _Atomic long long head, tail; // written by the input thread and the gui respectively
+#ifdef __linux__
+    int device;
+    bool kernel_time; // false if the device can't timestamp on the monotonic clock, then taps are timed when they are read
+    pthread_t thread;
+#endif
+    _Atomic int running;
+} wrzTapInput; // taps from --tap-device, timed by the kernel as they happen rather than whenever the gui gets to them
+
+typedef struct {
+    // input, either a capture device or a whole file played back in real time
+    ma_device device;
+    bool capturing;
+    float ring[WRZ_TRACK_RING]; // written by the capture callback
+    _Atomic long long written;
+    _Atomic double epoch; // wrzNow() at which input frame 0 was heard, kept up to date by the capture callback as the clocks drift
+    float * file; // --follow-file, NULL when capturing
+    long long file_frames;
+
+    // owned by the tracker thread, nothing is allocated once it is running
+    long long read; // input frames consumed
+    long long hops;
+    float frame[WRZ_TRACK_FFT]; // the latest WRZ_TRACK_FFT input frames, oldest first
+    float window[WRZ_TRACK_FFT];
+    float re[WRZ_TRACK_FFT], im[WRZ_TRACK_FFT];
+    float previous[WRZ_TRACK_FFT / 2 + 1]; // log magnitudes of the last spectrum
+    float envelope[WRZ_TRACK_HISTORY]; // onset strength of every hop, as a ring
+    float series[WRZ_TRACK_HISTORY]; // the envelope unrolled, for estimating
+    double candidate_bpm; // a jump in tempo has to be heard twice in a row before it is believed
+#ifndef _WIN32
+    pthread_t thread;
+#endif
+    _Atomic int running;
+
+    // written by the tracker thread, read by the gui
+    _Atomic double bpm;
+    _Atomic double beat_time; // wrzNow() at which the latest beat was heard
+    _Atomic long long estimates; // goes up by one every time the two above change
+} wrzBeatTracker;
+
+#ifndef _WIN32
+typedef struct wrzServer wrzServer;
+
+typedef struct {
+    wrzServer * server;
+    pthread_t thread;
+    double busy; // seconds spent rendering, owned by this worker
+} wrzServerWorker;
+
+struct wrzServer {
+    wrzSession * sessions;
+    int session_count;
+    wrzServerWorker workers[WRZ_SERVER_WORKERS];
+    int worker_count;
+
+    pthread_mutex_t lock; // guards everything below but next_session
+    pthread_cond_t tick_started, tick_done;
+    long long tick; // the block being rendered, workers wake up when it changes
+    int workers_done;
+    bool stopping;
+
+    _Atomic int next_session; // the first session nobody has taken yet this tick
+};
+#endif
+
+typedef struct {
+    unsigned char * data;
+    size_t bytes; // whole bytes written to `data` so far
+    unsigned long long bits; // the last few bits that don't make a byte yet, newest at the bottom
+    int bit_count;
+} wrzBitWriter; // msb first, like flac wants it
+
+typedef struct {
+    FILE * file;
+    int samples[2][WRZ_FLAC_BLOCK]; // left and side (left - right), int so the side has room for its extra bit
+    int pending; // frames in `samples` that haven't been encoded yet
+    int residual[WRZ_FLAC_BLOCK];
+    unsigned char frame[WRZ_FLAC_FRAME_BYTES];
+    long long frame_number, total_frames;
+    int min_frame_bytes, max_frame_bytes;
+} wrzFlacEncoder; // 16-bit stereo at WRZ_SAMPLE_RATE, fixed predictors only, which is plenty for clicks and silence
+
+typedef enum {
+    WRZ_UI_TITLE_BAR, WRZ_UI_TITLE_SHADOW, WRZ_UI_TITLE_TEXT, WRZ_UI_EXIT_TEXT,
+    WRZ_UI_TRIANGLE, WRZ_UI_BPM_TEXT, WRZ_UI_SUB_BPM_TEXT,
+    WRZ_UI_INPUT_BOX, WRZ_UI_SLIDER, WRZ_UI_SUBDIVISION, WRZ_UI_TAP,
+    WRZ_UI_PRIMARY_SOUND, WRZ_UI_SECONDARY_SOUND, WRZ_UI_COUNTERS,
+    WRZ_UI_LEFT_TEMPOS, // WRZ_TEMPO_BUTTONS of them
+    WRZ_UI_RIGHT_TEMPOS = WRZ_UI_LEFT_TEMPOS + WRZ_TEMPO_BUTTONS,
+    WRZ_UI_COUNT = WRZ_UI_RIGHT_TEMPOS + WRZ_TEMPO_BUTTONS
+} wrzWidget;
+
+typedef enum {
+    WRZ_ANCHOR_CANVAS, // scaled with the WIDTH x HEIGHT design, which is kept centred in the window
+    WRZ_ANCHOR_LEFT, WRZ_ANCHOR_RIGHT, // scaled, but measured from that top corner of the window rather than of the design
+    WRZ_ANCHOR_STRETCH // scaled height, always as wide as the window
+} wrzAnchor;
+
+typedef struct {
+    wrzWidget widget;
+    wrzAnchor anchor;
+    Rectangle design; // where it is in a WIDTH x HEIGHT window, text uses the height for its size
+    Vector2 step; // how far each of `repeat` widgets is from the one before it
+    int repeat;
+} wrzLayoutRule;
+
+typedef struct {
+    Rectangle rects[WRZ_UI_COUNT]; // in window coordinates
+    float scale; // window pixels per design pixel
+    float dpi; // framebuffer pixels per window pixel, text is rasterized at scale * dpi so it stays sharp
+    int width, height; // the window it was worked out for
+    int generation; // goes up every time it is worked out again, so anything cached from it knows to redo itself
+} wrzLayout;
+
+typedef struct {
+    Vector2 vertices[WRZ_PULSE_TRIANGLES * 3];
+    Color colors[WRZ_PULSE_TRIANGLES * 3];
+    int triangle_count;
+} wrzPulseMesh; // everything wrzBeatAnimation() draws, rebuilt every frame and sent to the gpu in one go
+
+typedef struct {
+    double last_swap; // wrzNow() just after the previous frame was handed to the screen, 0 before the first one
+    double period; // seconds between vsyncs, starts at the monitor's refresh rate and follows what the swaps actually do
+    double predicted; // what the last call to wrzPredictPresentTime() returned
+} wrzFramePacer;
+
+typedef struct {
+    wrzSession * session; // what the widgets change, not owned
+    wrzLayout layout; // everything is placed by this, worked out again whenever the window is resized
+    Font font;
+    Font bpm_digits, sub_bpm_digits; // the bpm readout is far bigger than the font was made for, so its digits get their own copy rasterized at that size
+    float text_spacing;
+    Color clear_color, fill_color, text_color; // read out of the style once, not every frame
+    char * input_buffer; // what wrzSpeedInputBox() shows and is typed into
+    int input_buffer_size;
+    wrzTapTempo tap_tempo;
+    long long tracker_estimates; // the beat tracker's estimate the tempo was last taken from
+    double tracked_beat; // wrzNow() of the latest beat the tracker heard, 0 if it had nothing new this frame
+    bool transport_following; // the jack thread sets the tempo, and the gui only shows it
+    bool show_counters; // F1
+    const char * midi_export_path; // where F2 exports to, NULL to not
+    bool relaid; // the layout was worked out again this frame, which loads new fonts and is allowed to allocate
+    double draw_start; // see wrzTraceBegin()
+    wrzBeatClockReading beat_clock; // what this frame's animation was drawn from
+    unsigned long long hash; // of what this frame showed, see wrzHashFrame()
+} wrzGui; // the window's half of a metronome, everything wrzGuiFrameBegin() and wrzGuiFrameEnd() keep from one frame to the next
+
+typedef struct {
+    Rectangle position; // relative to the top left of the text
+    Rectangle texcoords; // normalized, into the font's texture
+} wrzGlyphQuad;
+
+typedef struct {
+    char text[WRZ_LABEL_LENGTH];
+    unsigned int texture_id; // the font, size and spacing it was laid out with
+    float size, spacing;
+    int generation; // of the layout it was laid out for, a new layout reloads fonts and the driver may hand back the same texture_id
+    Vector2 measured; // what MeasureTextEx() would say
+    wrzGlyphQuad glyphs[WRZ_LABEL_LENGTH]; // spaces don't get one
+    int glyph_count;
+} wrzTextLabel; // text that is formatted, measured and laid out once, and drawn from that until it changes
+
+typedef struct {
+    FILE * file;
+    wrzFlacEncoder * flac; // NULL for a 16-bit wav
+    long long frames;
+} wrzTrackOutput; // somewhere --render and --batch write a finished click track to
+
+typedef struct {
+    char ** directories;
+    wrzBeatSounds ** sounds; // each allocated on its own, so pointers to them stay put as more are loaded
+    int count, capacity;
+} wrzSoundLibrary; // every beats directory loaded once, for the headless modes that play many metronomes at a time
+
+typedef struct {
+    int beats;
+    double bpm;
+} wrzTempoSegment;
+
+typedef struct {
+    char * output_path;
+    wrzTempoSegment * tempo_map; // played one after the other, the track ends when the last one does
+    int segment_count;
+    int subdivision;
+    wrzBeatSounds * sounds;
+    int beat_idx, sub_beat_idx;
+} wrzBatchJob;
+
+#ifndef _WIN32
+typedef struct {
+    wrzBatchJob * jobs;
+    int job_count;
+    _Atomic int next_job;
+    _Atomic int failed;
+    _Atomic long long frames_rendered;
+} wrzBatch;
+#endif
+
+//------------------------------------------------------------------------------
+
+extern wrzCounters wrz_counters; // see engine.c
+extern wrzFrameInput wrz_frame_input, wrz_last_frame_input; // see ui.c
+extern _Atomic int wrz_dump_requested, wrz_stop_requested;
+
+#ifdef WRZ_TRACK_ALLOCS // see engine.c
+extern _Thread_local _Atomic long long * wrz_thread_allocations; // which counter this thread's allocations go to, if any
+#define wrzCountAllocations(counter) (wrz_thread_allocations = (counter)) // from now on, this thread's allocations go to `counter`
+#define WRZ_COUNTS_ALLOCATIONS 1
+#else
+#define wrzCountAllocations(counter) ((void) (counter))
+#define WRZ_COUNTS_ALLOCATIONS 0
+#endif
+
+//------------------------------------------------------------------------------
+
+// engine.c
+double wrzNow(void);
+void wrzRecordStat(wrzStat * stat, double value);
+void wrzSaveCounters(const char * path);
+void wrzHandleDumpSignal(int signal);
+void wrzHandleStopSignal(int signal);
+void wrzAuditFrameAllocations(long long * seen, bool steady);
+void wrzStartTracing(void);
+void wrzTraceThread(const char * thread_name);
+double wrzTraceBegin(void);
+void wrzTraceRecord(const char * name, char phase, double start, double end, const char * arg_name, long long arg);
+void wrzTraceEnd(const char * name, double start, const char * arg_name, long long arg);
+void wrzTraceInstant(const char * name, const char * arg_name, long long arg);
+void wrzSaveTrace(const char * path);
+void wrzStopTracing(void);
+wrzBeatSounds wrzLoadBeatSounds(const char * dir);
+void wrzDestroyBeatSounds(wrzBeatSounds * b);
+wrzBeatSounds * wrzGetBeatSounds(wrzSoundLibrary * library, const char * directory);
+void wrzDestroySoundLibrary(wrzSoundLibrary * library);
+void wrzInitClickEngine(wrzClickEngine * e, wrzBeatSounds * sounds, int beat_idx, int sub_beat_idx);
+unsigned long long wrzHashBytes(unsigned long long hash, const void * data, size_t length);
+void wrzRenderClicks(wrzClickEngine * e, float * out, unsigned int frames);
+void wrzInitSession(wrzSession * s, wrzBeatSounds * sounds, int beat_idx, int sub_beat_idx, double bpm, int subdivision);
+void wrzReadBeatClock(wrzClickEngine * e, wrzBeatClockReading * reading);
+double wrzBeatPositionIn(const wrzBeatClockReading * reading, double time);
+double wrzBeatPositionAt(wrzClickEngine * e, double time);
+
+// config.c
+wrzProgramConfig wrzLoadProgramConfig(const char * filepath);
+void wrzSaveProgramConfig(wrzProgramConfig * c);
+void wrzDestroyProgramConfig(wrzProgramConfig * c);
+wrzCommandLine wrzParseCommandLine(int argc, char ** argv);
+
+// replay.c
+bool wrzOpenReplayRecorder(wrzReplayRecorder * r, const char * path, const wrzProgramConfig * config, const wrzSession * session);
+void wrzDrainReplayRecorder(wrzReplayRecorder * r);
+unsigned long long wrzHashFrame(const wrzGui * g, double beat);
+void wrzRecordFrame(wrzReplayRecorder * r, const wrzFrameInput * input, const wrzGui * g);
+void wrzCloseReplayRecorder(wrzReplayRecorder * r);
+int wrzReplayMain(wrzCommandLine * args);
+
+// audio.c
+void wrzLockAudioMemory(wrzBeatSounds * sounds, wrzClickEngine * engine, wrzAudioOutput * out);
+bool wrzOpenAudioOutput(wrzAudioOutput * out, wrzClickEngine * engine, const char * backend_name, int period_frames, int periods, bool realtime, float calibrated_latency_ms);
+void wrzCloseAudioOutput(wrzAudioOutput * out);
+bool wrzOpenJackOutput(wrzAudioOutput * out, wrzClickEngine * engine, bool follow_transport, float calibrated_latency_ms);
+float wrzCalibrateLatency(wrzClickEngine * engine, const char * backend_name, int period_frames, int periods);
+bool wrzOpenBeatTracker(wrzBeatTracker * t, const char * path);
+void wrzCloseBeatTracker(wrzBeatTracker * t);
+
+// io.c
+bool wrzOpenMidiOutput(wrzMidiOutput * m);
+void wrzCloseMidiOutput(wrzMidiOutput * m);
+void wrzWriteLittleEndian(unsigned char ** cursor, unsigned int value, int bytes);
+bool wrzExportMidiFile(const char * path, double bpm, int subdivision);
+bool wrzOpenSync(wrzSync * s, wrzClickEngine * engine, const char * address, bool leading);
+void wrzCloseSync(wrzSync * s);
+bool wrzTap(wrzTapTempo * t, double time);
+bool wrzPopTap(wrzTapInput * in, double * time);
+bool wrzOpenTapInput(wrzTapInput * in, const char * path);
+void wrzCloseTapInput(wrzTapInput * in);
+
+// encode.c
+void wrzWriteWavHeader(FILE * f, long long frames);
+void wrzFinishWav(FILE * f, long long frames);
+void wrzWritePcm16(FILE * f, const float * block, unsigned int frames);
+bool wrzOpenTrackOutput(wrzTrackOutput * out, const char * path, wrzFlacEncoder * encoder);
+void wrzWriteTrack(wrzTrackOutput * out, const float * block, unsigned int frames);
+long wrzCloseTrackOutput(wrzTrackOutput * out);
+
+// headless.c
+int wrzCalibrationMain(wrzCommandLine * args);
+int wrzServerMain(wrzCommandLine * args);
+int wrzStreamMain(wrzCommandLine * args);
+int wrzRenderMain(wrzCommandLine * args);
+int wrzBatchMain(wrzCommandLine * args);
+int wrzStressMain(void);
+
+// ui.c
+Font wrzLoadDigitFont(Font source, int size);
+Vector2 wrzGetMousePosition(void);
+float wrzGetMouseWheelMove(void);
+bool wrzIsMouseButtonDown(int button);
+bool wrzIsMouseButtonPressed(int button);
+bool wrzIsMouseButtonReleased(int button);
+bool wrzIsKeyDown(int key);
+bool wrzIsKeyPressed(int key);
+int wrzGetCharPressed(void);
+bool wrzUpdateLayout(wrzLayout * layout);
+int wrzSelectBeatSounds(const wrzLayout * layout, int * primary, int * secondary, int count);
+void wrzDrawStaticElements(const wrzLayout * layout, Font font, float text_spacing, Color bgc, Color c, Color txtc, long long underruns);
+void wrzSpeedSelectionSlider(const wrzLayout * layout, double * bpm);
+void wrzSpeedInputBox(const wrzLayout * layout, char ** input_buffer, int input_buffer_size, double * bpm);
+void wrzSpeedSelectionButtons(const wrzLayout * layout, double * bpm);
+bool wrzTapTempoButton(const wrzLayout * layout);
+void wrzSubdivisionSelectionButton(const wrzLayout * layout, int * subdivision);
+double wrzPredictPresentTime(wrzFramePacer * p, int refresh_rate);
+void wrzBeatAnimation(const wrzLayout * layout, double beat, int subdivision);
+void wrzDrawBPM(const wrzLayout * layout, double bpm, int subdivision, Font digits, Font sub_digits, float text_spacing, Color text_color);
+void wrzDrawCounters(const wrzLayout * layout, Font font, float text_spacing, Color bgc, Color txtc);
+void wrzReadFrameInput(wrzFrameInput * in, wrzFramePacer * pacer, int refresh_rate, wrzTapInput * taps, wrzBeatTracker * tracker, wrzSync * sync, wrzAudioOutput * output);
+void wrzOpenGui(wrzGui * g, wrzSession * session, const char * style_filepath);
+void wrzGuiFrameBegin(wrzGui * g, const wrzFrameInput * input);
+void wrzGuiFrameEnd(wrzGui * g);
+void wrzCloseGui(wrzGui * g);
+
+#endif
@@ -0,0 +1,25 @@
+// raygui's implementation, compiled on its own so that changing metronome.c doesn't mean compiling all of raygui again, see the Makefile
+#include <raylib.h>
+
+// raygui reads the mouse and keyboard through the gui's own input instead of raylib's, so --replay can hand it what --record logged, see ui.c
+// these are the functions raygui's header lists for a custom backend, declared here so raygui doesn't depend on metronome.h
+Vector2 wrzGetMousePosition(void);
+float wrzGetMouseWheelMove(void);
+bool wrzIsMouseButtonDown(int button);
+bool wrzIsMouseButtonPressed(int button);
+bool wrzIsMouseButtonReleased(int button);
+bool wrzIsKeyDown(int key);
+bool wrzIsKeyPressed(int key);
+int wrzGetCharPressed(void);
+
+#define GetMousePosition wrzGetMousePosition
+#define GetMouseWheelMove wrzGetMouseWheelMove
+#define IsMouseButtonDown wrzIsMouseButtonDown
+#define IsMouseButtonPressed wrzIsMouseButtonPressed
+#define IsMouseButtonReleased wrzIsMouseButtonReleased
+#define IsKeyDown wrzIsKeyDown
+#define IsKeyPressed wrzIsKeyPressed
+#define GetCharPressed wrzGetCharPressed
+
+#define RAYGUI_IMPLEMENTATION
+#include "raygui.h"
@@ -0,0 +1,317 @@
+// --record and --replay
+#include "metronome.h"
+
+// --record FILE: a header, then a line for every block the engine rendered (B) and every frame the gui drew (F), each frame after the
+// keys held (K), characters typed (C) and --tap-device taps (T) it read, if there were any. every double is written with %a, so it reads
+// back exactly, which is what makes --replay come out bit for bit the same
+bool wrzOpenReplayRecorder(wrzReplayRecorder * r, const char * path, const wrzProgramConfig * config, const wrzSession * session) {
+    memset(r, 0, sizeof(wrzReplayRecorder)); // also touches the whole ring now, instead of from the audio thread later
+
+    r->file = fopen(path, "w");
+    if(r->file == NULL) {
+        printf("WARNING: REPLAY: Could not open \"%s\" for writing, not recording.\n", path);
+        return false;
+    }
+
+    fprintf(r->file, "WRZREPLAY 2 %d\nSOUNDS %s\nSTYLE %s\nSTART %d %d\n", WRZ_SAMPLE_RATE, config->beats_directory,
+        (config->style_filepath != NULL) ? config->style_filepath : "", session->beat_idx, session->sub_beat_idx);
+    printf("INFO: REPLAY: Recording to \"%s\".\n", path);
+
+    return true;
+}
+
+// writes out every block the audio thread has pushed since the last call, from the gui thread
+void wrzDrainReplayRecorder(wrzReplayRecorder * r) {
+    long long written = atomic_load_explicit(&r->written, memory_order_acquire);
+
+    for(long long d = atomic_load_explicit(&r->drained, memory_order_relaxed); d < written; d++) {
+        wrzReplayBlock * b = &r->blocks[d % WRZ_REPLAY_RING];
+        fprintf(r->file, "B %u %a %a %a %a %a %d %d %d %lld %016llx\n", b->frames, b->block_time, b->bpm, b->tempo_scale, b->anchor, b->jump, b->subdivision, b->beat_idx, b->sub_beat_idx, b->gui_frame, b->hash);
+        r->frames_logged += b->frames;
+
+        atomic_store_explicit(&r->drained, d + 1, memory_order_release);
+    }
+}
+
+// what a frame showed: the tempo, subdivision and sounds the widgets were left at, what the text box says, and where the pulse was drawn
+unsigned long long wrzHashFrame(const wrzGui * g, double beat) {
+    const wrzSession * s = g->session;
+
+    unsigned long long hash = wrzHashBytes(14695981039346656037ULL, &beat, sizeof(beat));
+    hash = wrzHashBytes(hash, &s->bpm, sizeof(s->bpm));
+    hash = wrzHashBytes(hash, &s->subdivision, sizeof(s->subdivision));
+    hash = wrzHashBytes(hash, &s->beat_idx, sizeof(s->beat_idx));
+    hash = wrzHashBytes(hash, &s->sub_beat_idx, sizeof(s->sub_beat_idx));
+    return wrzHashBytes(hash, g->input_buffer, strlen(g->input_buffer));
+}
+
+// after wrzGuiFrameEnd(), `input` is what the frame was drawn from
+void wrzRecordFrame(wrzReplayRecorder * r, const wrzFrameInput * input, const wrzGui * g) {
+    wrzDrainReplayRecorder(r);
+    if(atomic_load(&r->overflowed)) return; // the blocks this frame would be checked against are missing
+
+    int held = 0;
+    for(int k = 1; k < WRZ_INPUT_KEYS; k++) {
+        if(input->keys[k / 8] & (1 << (k % 8))) fprintf(r->file, (held++ == 0) ? "K %d" : " %d", k);
+    }
+    if(held > 0) fputc('\n', r->file);
+
+    for(int i = 0; i < input->char_count; i++) fprintf(r->file, (i == 0) ? "C %d" : " %d", input->chars[i]);
+    if(input->char_count > 0) fputc('\n', r->file);
+
+    for(int i = 0; i < input->tap_count; i++) fprintf(r->file, (i == 0) ? "T %a" : " %a", input->taps[i]);
+    if(input->tap_count > 0) fputc('\n', r->file);
+
+    long long clock = (g->beat_clock.sequence == 0) ? -1 : (long long) g->beat_clock.clock;
+    fprintf(r->file, "F %lld %a %a %a %d %d %a %a %a %a %u %lld %a %a %d %a %d %d %a %lld %016llx\n", clock, input->now, input->present_time, input->frame_time,
+        input->width, input->height, input->dpi, input->mouse.x, input->mouse.y, input->wheel, input->buttons,
+        input->tracker_estimates, input->tracker_bpm, input->tracker_beat, input->have_leader, input->leader_bpm, input->leader_subdivision,
+        input->transport_rolling, input->transport_bpm, input->underruns, g->hash);
+}
+
+// after the audio output is closed, so the last blocks are in the ring
+void wrzCloseReplayRecorder(wrzReplayRecorder * r) {
+    if(r->file == NULL) return;
+
+    wrzDrainReplayRecorder(r);
+    fclose(r->file);
+    r->file = NULL;
+
+    if(atomic_load(&r->overflowed)) printf("WARNING: REPLAY: The gui fell behind the audio thread, the log only covers the first %.1f s.\n", (double) r->frames_logged / WRZ_SAMPLE_RATE);
+    else printf("INFO: REPLAY: Recorded %.1f s.\n", (double) r->frames_logged / WRZ_SAMPLE_RATE);
+}
+
+// the numbers after the letter a K, C or T line starts with, returns how many there were, or -1 if there are more than `max`
+int wrzReadLogNumbers(const char * line, double * values, int max) {
+    int count = 0;
+    char * end;
+
+    for(const char * at = line + 1; ; at = end) {
+        double value = strtod(at, &end);
+        if(end == at) break;
+        if(count == max) return -1;
+        values[count++] = value;
+    }
+
+    return count;
+}
+
+// renders logged block `b` on `e`, a copy of the engine that rendered it, and returns true if it came out the same
+// the engine gets what the replayed gui handed it, if the block read all of one frame's values and the gui is on that frame now.
+// otherwise, and for what the gui never sets, it gets what the log says the engine read. `gui_tempo` is false if the follower thread was setting the tempo too
+bool wrzRenderLoggedBlock(wrzClickEngine * e, const wrzReplayBlock * b, bool gui_tempo, float * buffer) {
+    atomic_store(&e->tempo_scale, b->tempo_scale);
+    atomic_store(&e->phase_jump, b->jump);
+    if(!gui_tempo) {
+        atomic_store(&e->bpm, b->bpm);
+        atomic_store(&e->subdivision, b->subdivision);
+    }
+
+    bool from_gui = b->gui_frame % 2 == 0 && b->gui_frame == atomic_load(&e->gui_frame); // odd, and it could have read some of either frame
+
+    double bpm = atomic_load(&e->bpm), anchor = atomic_load(&e->phase_anchor);
+    int subdivision = atomic_load(&e->subdivision), beat_idx = atomic_load(&e->beat_idx), sub_beat_idx = atomic_load(&e->sub_beat_idx);
+
+    if(!from_gui) {
+        atomic_store(&e->bpm, b->bpm);
+        atomic_store(&e->subdivision, b->subdivision);
+        atomic_store(&e->beat_idx, b->beat_idx);
+        atomic_store(&e->sub_beat_idx, b->sub_beat_idx);
+        atomic_store(&e->phase_anchor, b->anchor);
+    }
+
+    e->block_time = b->block_time;
+    wrzRenderClicks(e, buffer, b->frames);
+
+    if(!from_gui) { // back to what the gui left them at, minus the tap if this block is the one that took it
+        atomic_store(&e->bpm, bpm);
+        atomic_store(&e->subdivision, subdivision);
+        atomic_store(&e->beat_idx, beat_idx);
+        atomic_store(&e->sub_beat_idx, sub_beat_idx);
+        atomic_store(&e->phase_anchor, (anchor == b->anchor) ? 0.0 : anchor);
+    }
+
+    return wrzHashBytes(14695981039346656037ULL, buffer, b->frames * 2 * sizeof(float)) == b->hash;
+}
+
+// --replay FILE: run a --record log again on a virtual clock, as fast as it goes. the same widgets get the same input, in a window
+// that is never shown, and hand the click engine what they were set to, which renders every block at the point the audio thread did.
+// every block and every frame is checked against the log, so a change to the widgets, the layout or the engine that changes what is heard
+// or shown fails. with --render OUT the audio is written there as well; exits with 10 if anything came out different, and 11 if the log or OUT can't be used
+int wrzReplayMain(wrzCommandLine * args) {
+    FILE * log = fopen(args->replay_path, "r");
+    if(log == NULL) {
+        printf("ERROR: REPLAY: Could not open \"%s\"!\n", args->replay_path);
+        return 11;
+    }
+
+    char line[1024];
+    char directory[1024] = { 0 }, style[1024] = { 0 };
+    int version = 0, rate = 0, start_beat_idx = -1, start_sub_beat_idx = -1;
+
+    if(fgets(line, sizeof(line), log) == NULL || sscanf(line, "WRZREPLAY %d %d", &version, &rate) != 2 || version != 2 || rate != WRZ_SAMPLE_RATE
+        || fgets(directory, sizeof(directory), log) == NULL || strncmp(directory, "SOUNDS ", 7) != 0
+        || fgets(style, sizeof(style), log) == NULL || strncmp(style, "STYLE ", 6) != 0
+        || fgets(line, sizeof(line), log) == NULL || sscanf(line, "START %d %d", &start_beat_idx, &start_sub_beat_idx) != 2) {
+        printf("ERROR: REPLAY: \"%s\" is not a log this version can replay.\n", args->replay_path);
+        fclose(log);
+        return 11;
+    }
+    directory[strcspn(directory, "\r\n")] = '\0';
+    style[strcspn(style, "\r\n")] = '\0';
+
+    // the whole log is read first, a frame can be logged before the block it was drawn from
+    wrzReplayBlock * blocks = NULL;
+    wrzReplayFrame * frames = NULL;
+    int block_count = 0, block_capacity = 0, frame_count = 0, frame_capacity = 0;
+    bool bad = false, gui_tempo = true;
+
+    wrzFrameInput input = { 0 }; // filled in by the K, C and T lines until the F line it belongs to
+    double numbers[WRZ_INPUT_KEYS];
+
+    while(!bad && fgets(line, sizeof(line), log) != NULL) {
+        wrzReplayBlock b;
+        wrzReplayFrame f;
+        double frame_time, dpi, mouse_x, mouse_y, wheel;
+        int count = (line[0] == 'K' || line[0] == 'C' || line[0] == 'T') ? wrzReadLogNumbers(line, numbers, WRZ_INPUT_KEYS) : 0;
+
+        if(sscanf(line, "B %u %lf %lf %lf %lf %lf %d %d %d %lld %llx", &b.frames, &b.block_time, &b.bpm, &b.tempo_scale, &b.anchor, &b.jump, &b.subdivision, &b.beat_idx, &b.sub_beat_idx, &b.gui_frame, &b.hash) == 11) {
+            if(block_count == block_capacity) {
+                block_capacity = (block_capacity > 0) ? block_capacity * 2 : 1024;
+                blocks = realloc(blocks, block_capacity * sizeof(wrzReplayBlock));
+            }
+            blocks[block_count++] = b;
+        } else if(line[0] == 'K' && count > 0) {
+            for(int i = 0; i < count && !bad; i++) {
+                int key = (int) numbers[i];
+                bad = key <= 0 || key >= WRZ_INPUT_KEYS;
+                if(!bad) input.keys[key / 8] |= 1 << (key % 8);
+            }
+        } else if(line[0] == 'C' && count > 0 && count <= WRZ_INPUT_CHARS) {
+            for(int i = 0; i < count; i++) input.chars[i] = (int) numbers[i];
+            input.char_count = count;
+        } else if(line[0] == 'T' && count > 0 && count <= WRZ_INPUT_TAPS) {
+            memcpy(input.taps, numbers, count * sizeof(double));
+            input.tap_count = count;
+        } else if(sscanf(line, "F %lld %lf %lf %lf %d %d %lf %lf %lf %lf %u %lld %lf %lf %d %lf %d %d %lf %lld %llx", &f.clock, &input.now, &input.present_time, &frame_time,
+            &input.width, &input.height, &dpi, &mouse_x, &mouse_y, &wheel, &input.buttons,
+            &input.tracker_estimates, &input.tracker_bpm, &input.tracker_beat, &input.have_leader, &input.leader_bpm, &input.leader_subdivision,
+            &input.transport_rolling, &input.transport_bpm, &input.underruns, &f.hash) == 21) {
+            // the floats went out as doubles, so they come back exactly
+            input.frame_time = (float) frame_time;
+            input.dpi = (float) dpi;
+            input.mouse = (Vector2) { (float) mouse_x, (float) mouse_y };
+            input.wheel = (float) wheel;
+            if(input.have_leader) gui_tempo = false; // the follower thread hands the engine the leader's tempo itself, and the log can't say when
+
+            f.input = input;
+            memset(&input, 0, sizeof(wrzFrameInput));
+
+            if(frame_count == frame_capacity) {
+                frame_capacity = (frame_capacity > 0) ? frame_capacity * 2 : 1024;
+                frames = realloc(frames, frame_capacity * sizeof(wrzReplayFrame));
+            }
+            frames[frame_count++] = f;
+        } else bad = true;
+    }
+    fclose(log);
+
+    wrzBeatSounds sounds = wrzLoadBeatSounds(directory + 7);
+
+    bad = bad || start_beat_idx < 0 || start_beat_idx >= sounds.count || start_sub_beat_idx < 0 || start_sub_beat_idx >= sounds.count;
+
+    unsigned int max_frames = 0;
+    for(int i = 0; i < block_count && !bad; i++) {
+        bad = blocks[i].frames == 0 || blocks[i].beat_idx < 0 || blocks[i].beat_idx >= sounds.count || blocks[i].sub_beat_idx < 0 || blocks[i].sub_beat_idx >= sounds.count;
+        if(blocks[i].frames > max_frames) max_frames = blocks[i].frames;
+    }
+
+    if(bad) {
+        printf("ERROR: REPLAY: \"%s\" is damaged, or was recorded with different sounds than \"%s\" has now.\n", args->replay_path, directory + 7);
+        free(blocks);
+        free(frames);
+        wrzDestroyBeatSounds(&sounds);
+        return 11;
+    }
+
+    static wrzFlacEncoder encoder; // ~100 KiB, too much for the stack
+    wrzTrackOutput output = { 0 };
+    if(args->render_path != NULL && !wrzOpenTrackOutput(&output, args->render_path, &encoder)) {
+        printf("ERROR: REPLAY: Could not open \"%s\" for writing!\n", args->render_path);
+        free(blocks);
+        free(frames);
+        wrzDestroyBeatSounds(&sounds);
+        return 11;
+    }
+
+    // the session starts out just like the gui's did, and from then on only gets what the replayed gui hands it
+    wrzSession session;
+    wrzInitSession(&session, &sounds, start_beat_idx, start_sub_beat_idx, 60.0, 1);
+    session.engine.click_offset = NULL;
+
+    // the widgets draw as they go, so they need a window, but it never has to be seen and raylib's own input is never read
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(WIDTH, HEIGHT, "WRZ: Metronome v." VERSIONNO " -- replay");
+
+    wrzGui gui;
+    wrzOpenGui(&gui, &session, (style[6] != '\0') ? style + 6 : NULL);
+
+    float * buffer = malloc((max_frames > 0 ? max_frames : 1) * 2 * sizeof(float));
+    long long block_mismatches = 0, frame_mismatches = 0, from_log = 0, total = 0, first_mismatch = -1;
+    int first_frame_mismatch = -1, next_block = 0;
+    double start = wrzNow();
+
+    for(int i = 0; i <= frame_count; i++) { // one past the end for the blocks rendered after the last frame
+        bool last = i == frame_count;
+
+        // first the blocks the audio thread started before frame i handed anything over, as long as they were done by the time it read
+        // the beat clock; then in wrzGuiFrameBegin() it hands its values over, and the blocks finished while it did are rendered from the log
+        for(int pass = 0; pass < 2; pass++) {
+            while(next_block < block_count && (last || ((long long) atomic_load(&session.engine.frame_clock) <= frames[i].clock && (pass == 1 || blocks[next_block].gui_frame <= 2LL * i)))) {
+                wrzReplayBlock * b = &blocks[next_block++];
+
+                if(b->gui_frame % 2 != 0 || b->gui_frame != atomic_load(&session.engine.gui_frame)) from_log++;
+                if(!wrzRenderLoggedBlock(&session.engine, b, gui_tempo, buffer)) {
+                    if(first_mismatch < 0) first_mismatch = total;
+                    block_mismatches++;
+                }
+
+                if(output.file != NULL) wrzWriteTrack(&output, buffer, b->frames);
+                total += b->frames;
+            }
+
+            if(pass == 0 && !last) wrzGuiFrameBegin(&gui, &frames[i].input);
+        }
+
+        if(last) break;
+        wrzGuiFrameEnd(&gui);
+
+        long long drawn_from = (gui.beat_clock.sequence == 0) ? -1 : (long long) gui.beat_clock.clock;
+        if(drawn_from != frames[i].clock || gui.hash != frames[i].hash) {
+            if(first_frame_mismatch < 0) first_frame_mismatch = i;
+            frame_mismatches++;
+        }
+    }
+
+    double took = wrzNow() - start;
+
+    wrzCloseGui(&gui);
+    CloseWindow();
+
+    if(output.file != NULL) wrzCloseTrackOutput(&output);
+
+    double seconds = (double) total / WRZ_SAMPLE_RATE;
+    printf("INFO: REPLAY: Replayed %.1f s in %d blocks and %d frames, %.0fx real time.\n", seconds, block_count, frame_count, seconds / fmax(took, 1e-9));
+    if(from_log > 0) printf("INFO: REPLAY: %lld blocks couldn't be matched to one frame of the gui, they were given what the log says they read.\n", from_log);
+
+    if(block_mismatches > 0) printf("ERROR: REPLAY: %lld blocks rendered differently, the first at %.3f s.\n", block_mismatches, (double) first_mismatch / WRZ_SAMPLE_RATE);
+    if(frame_mismatches > 0) printf("ERROR: REPLAY: %lld frames were drawn differently, the first is frame %d.\n", frame_mismatches, first_frame_mismatch);
+    if(block_mismatches == 0 && frame_mismatches == 0) printf("INFO: REPLAY: Every block and frame came out the same.\n");
+
+    free(buffer);
+    free(blocks);
+    free(frames);
+    wrzDestroyBeatSounds(&sounds);
+
+    return (block_mismatches > 0 || frame_mismatches > 0) ? 10 : 0;
+}
@@ -0,0 +1,730 @@
+// the window: its layout, its widgets, and everything drawn in it
+#include "metronome.h"
+#include <rlgl.h> // cached text is drawn straight into raylib's batch, see wrzDrawLabel()
+#include "raygui.h" // the implementation is compiled separately, see raygui.c
+
+// the frame being drawn and the one before it, see wrzGuiFrameBegin()
+wrzFrameInput wrz_frame_input = { 0 }, wrz_last_frame_input = { 0 };
+
+// the gui (raygui included, see raygui.c) reads the mouse and keyboard through these, which answer from wrz_frame_input instead of
+// asking raylib, so --replay can run the widgets on exactly what --record logged. pressed and released are worked out like raylib does,
+// from whether it was down the frame before
+Vector2 wrzGetMousePosition(void) {
+    return wrz_frame_input.mouse;
+}
+
+float wrzGetMouseWheelMove(void) {
+    return wrz_frame_input.wheel;
+}
+
+bool wrzIsMouseButtonDown(int button) {
+    return button >= 0 && button < WRZ_INPUT_BUTTONS && (wrz_frame_input.buttons & (1u << button));
+}
+
+bool wrzIsMouseButtonPressed(int button) {
+    return wrzIsMouseButtonDown(button) && !(wrz_last_frame_input.buttons & (1u << button));
+}
+
+bool wrzIsMouseButtonReleased(int button) {
+    return button >= 0 && button < WRZ_INPUT_BUTTONS && !wrzIsMouseButtonDown(button) && (wrz_last_frame_input.buttons & (1u << button));
+}
+
+bool wrzIsKeyDown(int key) {
+    return key > 0 && key < WRZ_INPUT_KEYS && (wrz_frame_input.keys[key / 8] & (1 << (key % 8)));
+}
+
+bool wrzIsKeyPressed(int key) {
+    return wrzIsKeyDown(key) && !(wrz_last_frame_input.keys[key / 8] & (1 << (key % 8)));
+}
+
+int wrzGetCharPressed(void) { // 0 once this frame's are used up, like GetCharPressed()
+    return (wrz_frame_input.chars_taken < wrz_frame_input.char_count) ? wrz_frame_input.chars[wrz_frame_input.chars_taken++] : 0;
+}
+
+//------------------------------------------------------------------------------
+
+// the glyphs of WRZ_DIGITS from `source`, rasterized once at `size` px so they are drawn 1:1 instead of scaled up every frame
+// the gui fonts are small bitmaps, so each glyph is sampled smoothly and thresholded halfway, which keeps the edges crisp at any size
+// unload it with UnloadFont(), it only has the glyphs in WRZ_DIGITS, anything else draws as the first of them
+Font wrzLoadDigitFont(Font source, int size) {
+    int count = (int) strlen(WRZ_DIGITS);
+    float scale = (float) size / source.baseSize;
+    float padding = (float) source.glyphPadding;
+
+    Image source_image = LoadImageFromTexture(source.texture); // read back from the gpu, the gui fonts don't keep their pixels around
+    Color * source_pixels = LoadImageColors(source_image);
+
+    Font font = { 0 };
+    font.baseSize = size;
+    font.glyphCount = count;
+    font.recs = calloc(count, sizeof(Rectangle));
+    font.glyphs = calloc(count, sizeof(GlyphInfo));
+
+    // one row of cells, a couple of pixels apart so the filtering never bleeds one into the next
+    int width = 2, height = 0;
+    for(int i = 0; i < count; i++) {
+        Rectangle rec = source.recs[GetGlyphIndex(source, WRZ_DIGITS[i])];
+        int cell_width = (int) ceilf((rec.width + 2 * padding) * scale), cell_height = (int) ceilf((rec.height + 2 * padding) * scale);
+
+        font.recs[i] = (Rectangle) { (float) width, 2.0f, (float) cell_width, (float) cell_height };
+        width += cell_width + 2;
+        if(cell_height + 4 > height) height = cell_height + 4;
+    }
+
+    Color * pixels = calloc(width * height, sizeof(Color)); // transparent white-to-be, the tint gives the color
+
+    for(int i = 0; i < count; i++) {
+        int index = GetGlyphIndex(source, WRZ_DIGITS[i]);
+        GlyphInfo glyph = source.glyphs[index];
+        Rectangle rec = source.recs[index];
+        Rectangle cell = font.recs[i];
+
+        // the padded source rectangle, anything outside of it counts as empty
+        int left = (int) (rec.x - padding), top = (int) (rec.y - padding);
+        int source_width = (int) (rec.width + 2 * padding), source_height = (int) (rec.height + 2 * padding);
+
+        for(int y = 0; y < (int) cell.height; y++) {
+            for(int x = 0; x < (int) cell.width; x++) {
+                // bilinear coverage at the centre of this pixel, in source pixels
+                float u = (x + 0.5f) / scale - 0.5f, v = (y + 0.5f) / scale - 0.5f;
+                int u0 = (int) floorf(u), v0 = (int) floorf(v);
+                float fu = u - u0, fv = v - v0;
+
+                float corners[4];
+                for(int c = 0; c < 4; c++) {
+                    int su = u0 + (c & 1), sv = v0 + (c >> 1);
+                    bool inside = su >= 0 && sv >= 0 && su < source_width && sv < source_height;
+                    corners[c] = inside ? source_pixels[(top + sv) * source_image.width + left + su].a / 255.0f : 0.0f;
+                }
+                float coverage = (corners[0] * (1 - fu) + corners[1] * fu) * (1 - fv) + (corners[2] * (1 - fu) + corners[3] * fu) * fv;
+
+                // the edge is where the coverage crosses a half, and it goes from 0 to 1 over `scale` pixels, so this antialiases over one
+                float alpha = Clamp((coverage - 0.5f) * scale + 0.5f, 0.0f, 1.0f);
+                pixels[((int) cell.y + y) * width + (int) cell.x + x] = (Color) { 255, 255, 255, (unsigned char) (alpha * 255.0f + 0.5f) };
+            }
+        }
+
+        font.glyphs[i].value = WRZ_DIGITS[i];
+        font.glyphs[i].offsetX = (int) lrintf((glyph.offsetX - padding) * scale);
+        font.glyphs[i].offsetY = (int) lrintf((glyph.offsetY - padding) * scale);
+        font.glyphs[i].advanceX = (int) lrintf(((glyph.advanceX == 0) ? rec.width : (float) glyph.advanceX) * scale);
+    }
+
+    Image atlas = { pixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    font.texture = LoadTextureFromImage(atlas);
+    SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR); // only for positions between pixels, it is always drawn at its own size
+
+    free(pixels);
+    UnloadImageColors(source_pixels);
+    UnloadImage(source_image);
+
+    return font;
+}
+
+// lays `text` out again only if it, the layout, the font, the size or the spacing is different from last time, so calling it every frame is cheap
+void wrzSetLabel(wrzTextLabel * label, const wrzLayout * layout, Font font, float size, float spacing, const char * text) {
+    if(label->generation == layout->generation && label->texture_id == font.texture.id && label->size == size && label->spacing == spacing && strcmp(label->text, text) == 0) return;
+
+    if(text != label->text) snprintf(label->text, sizeof(label->text), "%s", text);
+    label->generation = layout->generation;
+    label->texture_id = font.texture.id;
+    label->size = size;
+    label->spacing = spacing;
+    label->measured = MeasureTextEx(font, label->text, size, spacing);
+
+    // the same placement DrawTextEx() and DrawTextCodepoint() work out for every glyph every time they draw it
+    float scale = size / font.baseSize;
+    float padding = (float) font.glyphPadding;
+    float x = 0.0f;
+
+    label->glyph_count = 0;
+    for(int i = 0; label->text[i] != '\0';) {
+        int bytes = 0;
+        int codepoint = GetCodepointNext(&label->text[i], &bytes);
+        int index = GetGlyphIndex(font, codepoint);
+        Rectangle rec = font.recs[index];
+        i += bytes;
+
+        if(codepoint != ' ' && codepoint != '\t') {
+            wrzGlyphQuad * quad = &label->glyphs[label->glyph_count++];
+            quad->position = (Rectangle) { x + (font.glyphs[index].offsetX - padding) * scale, (font.glyphs[index].offsetY - padding) * scale,
+                (rec.width + 2 * padding) * scale, (rec.height + 2 * padding) * scale };
+            quad->texcoords = (Rectangle) { (rec.x - padding) / font.texture.width, (rec.y - padding) / font.texture.height,
+                (rec.width + 2 * padding) / font.texture.width, (rec.height + 2 * padding) / font.texture.height };
+        }
+
+        x += ((font.glyphs[index].advanceX == 0) ? rec.width : (float) font.glyphs[index].advanceX) * scale + spacing;
+    }
+}
+
+// draws what wrzSetLabel() laid out as one run of quads, which is all DrawTextEx() ends up doing after its per-glyph lookups
+void wrzDrawLabel(const wrzTextLabel * label, Vector2 position, Color color) {
+    if(label->glyph_count == 0) return;
+
+    rlCheckRenderBatchLimit(4 * label->glyph_count);
+    rlSetTexture(label->texture_id);
+    rlBegin(RL_QUADS);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+
+        for(int i = 0; i < label->glyph_count; i++) {
+            Rectangle p = label->glyphs[i].position;
+            Rectangle t = label->glyphs[i].texcoords;
+            float x = position.x + p.x, y = position.y + p.y;
+
+            rlTexCoord2f(t.x, t.y);                         rlVertex2f(x, y);
+            rlTexCoord2f(t.x, t.y + t.height);              rlVertex2f(x, y + p.height);
+            rlTexCoord2f(t.x + t.width, t.y + t.height);    rlVertex2f(x + p.width, y + p.height);
+            rlTexCoord2f(t.x + t.width, t.y);               rlVertex2f(x + p.width, y);
+        }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+//------------------------------------------------------------------------------
+
+// the whole window, as it was laid out for WIDTH x HEIGHT, wrzUpdateLayout() scales it to the actual window
+// text is placed by its top left (WRZ_UI_TITLE_TEXT), top right (WRZ_UI_EXIT_TEXT), or top centre (the bpm), the triangle by its centre and radius
+const wrzLayoutRule wrz_layout_rules[] = {
+    { WRZ_UI_TITLE_BAR,       WRZ_ANCHOR_STRETCH, {          0,   0,     0,  40 }, {   0,  0 }, 0 },
+    { WRZ_UI_TITLE_SHADOW,    WRZ_ANCHOR_STRETCH, {          0,   0,     0,  50 }, {   0,  0 }, 0 },
+    { WRZ_UI_TITLE_TEXT,      WRZ_ANCHOR_LEFT,    {         10,  10,     0,  20 }, {   0,  0 }, 0 },
+    { WRZ_UI_EXIT_TEXT,       WRZ_ANCHOR_RIGHT,   {         10,  10,     0,  20 }, {   0,  0 }, 0 },
+    { WRZ_UI_COUNTERS,        WRZ_ANCHOR_LEFT,    {         10,  60,   360, 202 }, {   0,  0 }, 0 },
+    { WRZ_UI_TRIANGLE,        WRZ_ANCHOR_CANVAS,  {  WIDTH / 2, 550,   400,   0 }, {   0,  0 }, 0 },
+    { WRZ_UI_BPM_TEXT,        WRZ_ANCHOR_CANVAS,  {  WIDTH / 2, 450,     0, 140 }, {   0,  0 }, 0 },
+    { WRZ_UI_SUB_BPM_TEXT,    WRZ_ANCHOR_CANVAS,  {  WIDTH / 2, 575,     0,  40 }, {   0,  0 }, 0 },
+    { WRZ_UI_LEFT_TEMPOS,     WRZ_ANCHOR_CANVAS,  {        480, 180,   100,  50 }, { -35, 60 }, WRZ_TEMPO_BUTTONS },
+    { WRZ_UI_RIGHT_TEMPOS,    WRZ_ANCHOR_CANVAS,  {        620, 180,   100,  50 }, {  35, 60 }, WRZ_TEMPO_BUTTONS },
+    { WRZ_UI_INPUT_BOX,       WRZ_ANCHOR_CANVAS,  {        250, 800,   140,  40 }, {   0,  0 }, 0 },
+    { WRZ_UI_SLIDER,          WRZ_ANCHOR_CANVAS,  {        400, 800,   400,  40 }, {   0,  0 }, 0 },
+    { WRZ_UI_SUBDIVISION,     WRZ_ANCHOR_CANVAS,  {        850, 800,    50,  40 }, {   0,  0 }, 0 },
+    { WRZ_UI_TAP,             WRZ_ANCHOR_CANVAS,  {        920, 800,    80,  40 }, {   0,  0 }, 0 },
+    { WRZ_UI_PRIMARY_SOUND,   WRZ_ANCHOR_CANVAS,  {        450, 850,   150,  40 }, {   0,  0 }, 0 },
+    { WRZ_UI_SECONDARY_SOUND, WRZ_ANCHOR_CANVAS,  {        600, 850,   150,  40 }, {   0,  0 }, 0 },
+};
+
+// works the rectangles out again if the window has changed size or moved to a screen with a different dpi since last time
+// returns true if it did, which is the only time anything that depends on the size of the window has to change
+bool wrzUpdateLayout(wrzLayout * layout) {
+    int width = wrz_frame_input.width, height = wrz_frame_input.height;
+    float dpi = wrz_frame_input.dpi;
+    if(layout->generation > 0 && width == layout->width && height == layout->height && dpi == layout->dpi) return false;
+
+    layout->width = width;
+    layout->height = height;
+    layout->dpi = (dpi > 0.0f) ? dpi : 1.0f;
+    layout->scale = fminf((float) width / WIDTH, (float) height / HEIGHT);
+
+    float s = layout->scale;
+    Vector2 canvas = { (width - WIDTH * s) / 2, (height - HEIGHT * s) / 2 }; // the design keeps its shape, with bars either side if the window doesn't
+
+    for(int r = 0; r < (int) (sizeof(wrz_layout_rules) / sizeof(wrz_layout_rules[0])); r++) {
+        const wrzLayoutRule * rule = &wrz_layout_rules[r];
+
+        for(int i = 0; i < ((rule->repeat > 0) ? rule->repeat : 1); i++) {
+            Rectangle d = { rule->design.x + rule->step.x * i, rule->design.y + rule->step.y * i, rule->design.width, rule->design.height };
+            Rectangle * out = &layout->rects[rule->widget + i];
+
+            switch(rule->anchor) {
+                case WRZ_ANCHOR_CANVAS: *out = (Rectangle) { canvas.x + d.x * s, canvas.y + d.y * s, d.width * s, d.height * s }; break;
+                case WRZ_ANCHOR_LEFT: *out = (Rectangle) { d.x * s, d.y * s, d.width * s, d.height * s }; break;
+                case WRZ_ANCHOR_RIGHT: *out = (Rectangle) { width - d.x * s, d.y * s, d.width * s, d.height * s }; break;
+                case WRZ_ANCHOR_STRETCH: *out = (Rectangle) { 0, d.y * s, (float) width, d.height * s }; break;
+            }
+        }
+    }
+
+    layout->generation++;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+int wrzSelectBeatSounds(const wrzLayout * layout, int * primary, int * secondary, int count) {
+    // the labels are only formatted when the sounds change, not every frame
+    static char primary_text[12], secondary_text[12];
+    static int shown_primary = -1, shown_secondary = -1;
+    if(*primary != shown_primary) snprintf(primary_text, sizeof(primary_text), "%1d", (shown_primary = *primary) + 1);
+    if(*secondary != shown_secondary) snprintf(secondary_text, sizeof(secondary_text), "%1d", (shown_secondary = *secondary) + 1);
+
+    if( GuiButton(layout->rects[WRZ_UI_PRIMARY_SOUND], primary_text) ) {
+        // render the second button, because we won't get that far in the code
+        GuiButton(layout->rects[WRZ_UI_SECONDARY_SOUND], secondary_text);
+        *primary = ((((int) *primary + 1)) % count); // increment primary counter with overflow
+        return 1; // inform that the primary has changed
+    }
+    if( GuiButton(layout->rects[WRZ_UI_SECONDARY_SOUND], secondary_text) ) {
+        // first button has already rendered, so no need to repeat it here
+        *secondary = ((((int) *secondary + 1)) % count); // increment secondary counter with overflow
+        return 2; // inform that the secondary has changed
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void wrzDrawStaticElements(const wrzLayout * layout, Font font, float text_spacing, Color bgc, Color c, Color txtc, long long underruns) {
+    static wrzTextLabel title, to_exit;
+    static char title_text[WRZ_LABEL_LENGTH];
+    static int shown_fps = -1;
+    static long long shown_underruns = -1;
+
+    // the fps only changes a few times a second and the underruns hardly ever, so the title is only formatted when they do
+    int fps = GetFPS();
+    if(fps != shown_fps || underruns != shown_underruns) {
+        snprintf(title_text, sizeof(title_text), "WRZ: Metronome v.%s -- %03d FPS -- %lld underruns", VERSIONNO, fps, underruns);
+        shown_fps = fps;
+        shown_underruns = underruns;
+    }
+
+    Rectangle title_at = layout->rects[WRZ_UI_TITLE_TEXT], to_exit_at = layout->rects[WRZ_UI_EXIT_TEXT];
+    wrzSetLabel(&title, layout, font, title_at.height, text_spacing * layout->scale, title_text);
+    // "static" of course meaning non-user-interactable, not completely unchanging.
+    wrzSetLabel(&to_exit, layout, font, to_exit_at.height, text_spacing * layout->scale, "Press ESC to exit.");
+
+    int to_exit_width = (int) to_exit.measured.x;
+
+    //------------------------------------------------------------------------------
+    DrawRectangleRec(layout->rects[WRZ_UI_TITLE_SHADOW], Fade(c, .50f)); // background for title text
+    DrawRectangleRec(layout->rects[WRZ_UI_TITLE_BAR], c);
+
+    wrzDrawLabel(&title, (Vector2) { title_at.x, title_at.y }, txtc);
+    wrzDrawLabel(&to_exit, (Vector2) { (to_exit_at.x - to_exit_width), to_exit_at.y }, txtc);
+    //------------------------------------------------------------------------------
+    Rectangle triangle = layout->rects[WRZ_UI_TRIANGLE];
+    Vector2 centre = { triangle.x, triangle.y };
+    DrawPoly(centre, 3, triangle.width + 60 * layout->scale, 30.0f, bgc); // main metronome background triangle
+    DrawPoly(centre, 3, triangle.width + 40 * layout->scale, 30.0f, Fade(c, .25f));
+    DrawPoly(centre, 3, triangle.width + 20 * layout->scale, 30.0f, Fade(c, .50f));
+    DrawPoly(centre, 3, triangle.width, 30.0f, c);
+}
+
+//------------------------------------------------------------------------------
+
+// NOTE: modifies `bpm`
+// the slider only works in floats, so `bpm` is only touched when it is actually dragged, and then to the nearest hundredth
+void wrzSpeedSelectionSlider(const wrzLayout * layout, double * bpm) {
+    float value = (float) *bpm;
+    GuiSliderBar(layout->rects[WRZ_UI_SLIDER], NULL, NULL, &value, 1, WRZ_MAX_BPM);
+    if(value != (float) *bpm) *bpm = round(value * 100.0) / 100.0;
+}
+
+// NOTE: modifies `bpm`
+// click the box (or it starts out selected) to type, enter or clicking away sets the tempo, anything that isn't a tempo is ignored
+void wrzSpeedInputBox(const wrzLayout * layout, char ** input_buffer, int input_buffer_size, double * bpm) {
+    static bool editing = false;
+
+    if(!editing) snprintf(*input_buffer, input_buffer_size, "%.7g", *bpm); // shows what the slider and buttons set, but leaves alone what is being typed
+
+    if( GuiTextBox(layout->rects[WRZ_UI_INPUT_BOX], *input_buffer, input_buffer_size - 1, editing) ) {
+        if(editing) {
+            char * end;
+            double typed = strtod(*input_buffer, &end);
+            if(end != *input_buffer && typed >= 1.0 && typed <= WRZ_MAX_BPM) *bpm = typed;
+        }
+        editing = !editing;
+    }
+}
+
+// TODO: put this in the configuration file
+// used in wrzSpeedSelectionButtons(), just some common tempi to be rendered in button form for ease of use
+// these are customizable, just edit this list. max bpm is WRZ_MAX_BPM, min is 1, and there can be up to WRZ_TEMPO_BUTTONS on each side
+int left_side_numbers[9] =  { 108, 120, 128, 132, 136, 140, 144, 148, 152 };
+int right_side_numbers[9] = { 100, 96,  92,  88,  80,  72,  66,  60,  52 };
+
+// NOTE: modifies `bpm`
+void wrzSpeedSelectionButtons(const wrzLayout * layout, double * bpm) {
+    // the lists never change while running, so the labels are formatted on the first frame and kept
+    static char left_labels[sizeof(left_side_numbers) / sizeof(int)][16], right_labels[sizeof(right_side_numbers) / sizeof(int)][16];
+    static bool formatted = false;
+
+    if(!formatted) {
+        for(int i = 0; i < (sizeof(left_side_numbers) / sizeof(int)); i++) { //                                 ------         ------- ternary checks for necessary offset
+            snprintf(left_labels[i], sizeof(left_labels[i]), (left_side_numbers[i] > 99) ? "%03d      " : "%02d       ", left_side_numbers[i]);
+        }
+        for(int j = 0; j < (sizeof(right_side_numbers) / sizeof(int)); j++) {
+            snprintf(right_labels[j], sizeof(right_labels[j]), (right_side_numbers[j] > 99) ? "      %03d" : "       %02d", right_side_numbers[j]);
+        }
+        formatted = true;
+    }
+
+    // left side, dx = -35, dy = 60, see wrz_layout_rules
+    for(int i = 0; i < (sizeof(left_side_numbers) / sizeof(int)); i++) {
+        if( GuiButton(layout->rects[WRZ_UI_LEFT_TEMPOS + i], left_labels[i]) ) *bpm = (double) left_side_numbers[i];
+    }
+
+    // right side, now, dx = 35
+    for(int j = 0; j < (sizeof(right_side_numbers) / sizeof(int)); j++) { // i like to use i, j, k, l when i'm making two loops that do pretty much the same thing; this is not necessary
+        if( GuiButton(layout->rects[WRZ_UI_RIGHT_TEMPOS + j], right_labels[j]) ) *bpm = (double) right_side_numbers[j];
+    }
+}
+
+// returns true on the frame the button goes down (not up, like GuiButton()) or T is pressed, since that is when the beat is
+bool wrzTapTempoButton(const wrzLayout * layout) {
+    Rectangle bounds = layout->rects[WRZ_UI_TAP];
+    GuiButton(bounds, "TAP");
+
+    return wrzIsKeyPressed(KEY_T) || (wrzIsMouseButtonPressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(wrzGetMousePosition(), bounds));
+}
+
+//------------------------------------------------------------------------------
+
+// left click counts up, right click counts down, both wrap around at WRZ_MAX_SUBDIVISION
+void wrzSubdivisionSelectionButton(const wrzLayout * layout, int * subdivision) {
+    Rectangle bounds = layout->rects[WRZ_UI_SUBDIVISION];
+
+    static char text[12];
+    static int shown = -1;
+    if(*subdivision != shown) snprintf(text, sizeof(text), "%1d", (shown = *subdivision));
+
+    // render button with overflow
+    if( GuiButton(bounds, text)) *subdivision = ((*subdivision) % WRZ_MAX_SUBDIVISION) + 1;
+    else if(wrzIsMouseButtonPressed(MOUSE_BUTTON_RIGHT) && CheckCollisionPointRec(wrzGetMousePosition(), bounds)) *subdivision = ((*subdivision + WRZ_MAX_SUBDIVISION - 2) % WRZ_MAX_SUBDIVISION) + 1;
+}
+
+//------------------------------------------------------------------------------
+
+// call once a frame, before anything is drawn, returns the wrzNow() at which what is about to be drawn will be on screen
+// with vsync the previous swap returned at (about) a vsync, so this frame goes up one period after it, unless it takes longer than that to draw
+double wrzPredictPresentTime(wrzFramePacer * p, int refresh_rate) {
+    double now = wrzNow();
+
+    if(p->last_swap > 0.0) {
+        double interval = now - p->last_swap;
+        wrzRecordStat(&wrz_counters.gui.present_error, (now - p->predicted) * 1000.0);
+
+        // a missed vsync says nothing about how long the rest of them are, so only near-periods are averaged in
+        if(interval > p->period * 0.5 && interval < p->period * 1.5) p->period += (interval - p->period) / 16.0;
+    } else p->period = 1.0 / ((refresh_rate > 0) ? refresh_rate : 60);
+
+    p->last_swap = now;
+    p->predicted = now + p->period;
+    return p->predicted;
+}
+
+// the same shape DrawPoly() makes, but added to `mesh` instead of drawn on its own
+void wrzPushPoly(wrzPulseMesh * mesh, Vector2 centre, int sides, float radius, float rotation, Color color) {
+    float angle = rotation * DEG2RAD, step = 2.0f * PI / sides;
+
+    for(int i = 0; i < sides && mesh->triangle_count < WRZ_PULSE_TRIANGLES; i++) {
+        Vector2 * v = &mesh->vertices[mesh->triangle_count * 3];
+        Color * c = &mesh->colors[mesh->triangle_count * 3];
+
+        // same winding as DrawPoly(), so it isn't culled
+        v[0] = centre;
+        v[1] = (Vector2) { centre.x + cosf(angle + step) * radius, centre.y + sinf(angle + step) * radius };
+        v[2] = (Vector2) { centre.x + cosf(angle) * radius, centre.y + sinf(angle) * radius };
+        c[0] = c[1] = c[2] = color;
+
+        mesh->triangle_count++;
+        angle += step;
+    }
+}
+
+void wrzDrawPulseMesh(const wrzPulseMesh * mesh) {
+    if(mesh->triangle_count == 0) return;
+
+    rlCheckRenderBatchLimit(3 * mesh->triangle_count);
+    rlBegin(RL_TRIANGLES);
+        for(int i = 0; i < mesh->triangle_count * 3; i++) {
+            Color c = mesh->colors[i];
+            rlColor4ub(c.r, c.g, c.b, c.a);
+            rlVertex2f(mesh->vertices[i].x, mesh->vertices[i].y);
+        }
+    rlEnd();
+}
+
+// how big a pulse is `phase` of the way from one click to the next
+// multiplied by 1.1f and then clamped so that the triangle stays at its widest for the briefest instant
+// this helps with establishing the visual timing cue if it just stays still for a small amount of time
+float wrzPulseScale(double phase) {
+    return Clamp(1.1f * (1.0f - (float) phase), 0.0f, 1.0f);
+}
+
+// `beat` is from wrzBeatPositionAt() at the time the frame will be shown, so everything peaks exactly when its click is heard
+// the big triangle pulses on every beat and a smaller one inside it on every sub-beat, and with a subdivision there is a row of dots
+// along the bottom edge, one per click in the beat with the first (the beat itself) bigger, lit up in turn
+void wrzBeatAnimation(const wrzLayout * layout, double beat, int subdivision) {
+    static wrzPulseMesh mesh; // rebuilt every frame, but never reallocated
+    mesh.triangle_count = 0;
+
+    Rectangle triangle = layout->rects[WRZ_UI_TRIANGLE];
+    Vector2 centre = { triangle.x, triangle.y };
+    float radius = triangle.width;
+
+    bool playing = !isnan(beat);
+    double beat_phase = playing ? beat - floor(beat) : 1.0;
+    double sub_position = playing ? beat_phase * subdivision : 0.0;
+    int sub_beat = (int) sub_position;
+
+    float scale = wrzPulseScale(beat_phase);
+    wrzPushPoly(&mesh, centre, 3, radius * scale, 30.0f, Fade(GRAY, 0.2f * scale));
+
+    if(subdivision > 1) {
+        float sub_scale = (sub_beat > 0) ? wrzPulseScale(sub_position - sub_beat) : 0.0f; // the beat has its own pulse
+        wrzPushPoly(&mesh, centre, 3, radius * 0.5f * sub_scale, 30.0f, Fade(GRAY, 0.3f * sub_scale));
+
+        // the bottom edge is radius / 2 below the centre, the dots sit just above it
+        float y = centre.y + radius * 0.38f;
+        float spacing = (radius * 1.2f) / (subdivision - 1);
+        float dot = fminf(radius * 0.035f, spacing / 3.0f);
+
+        for(int i = 0; i < subdivision; i++) {
+            float lit = (playing && i == sub_beat) ? wrzPulseScale(sub_position - sub_beat) : 0.0f;
+            Vector2 at = { centre.x - radius * 0.6f + spacing * i, y };
+            wrzPushPoly(&mesh, at, 6, dot * ((i == 0) ? 1.5f : 1.0f) * (1.0f + 0.3f * lit), 0.0f, Fade(GRAY, 0.3f + 0.7f * lit));
+        }
+    }
+
+    wrzDrawPulseMesh(&mesh);
+}
+
+// maybe this and wrzDrawSubBPM() should just be one function?
+// fractional tempos are drawn with as many digits as they were given, whole ones without a decimal point
+// `digits` and `sub_digits` are from wrzLoadDigitFont(), at the sizes of WRZ_UI_BPM_TEXT and WRZ_UI_SUB_BPM_TEXT
+void wrzDrawBPM(const wrzLayout * layout, double bpm, int subdivision, Font digits, Font sub_digits, float text_spacing, Color text_color) {
+    static wrzTextLabel label, sub_label;
+    static char text[32], sub_text[32];
+    static double shown_bpm = -1.0;
+    static int shown_subdivision = -1;
+
+    // only formatted when the tempo changes, which is hardly ever compared to how often it is drawn
+    if(bpm != shown_bpm || subdivision != shown_subdivision) {
+        snprintf(text, sizeof(text), "%.7g", bpm);
+        snprintf(sub_text, sizeof(sub_text), "%.7g", bpm * subdivision);
+        shown_bpm = bpm;
+        shown_subdivision = subdivision;
+    }
+
+    Rectangle at = layout->rects[WRZ_UI_BPM_TEXT], sub_at = layout->rects[WRZ_UI_SUB_BPM_TEXT];
+
+    wrzSetLabel(&label, layout, digits, at.height, text_spacing * layout->scale, text);
+    int width = label.measured.x;
+    wrzDrawLabel(&label, (Vector2) { (int) at.x - width / 2, at.y }, text_color);
+
+    if(subdivision > 1) { // do not render sub-bpm text if it's the same (bpm * 1 = bpm) as the base bpm
+        wrzSetLabel(&sub_label, layout, sub_digits, sub_at.height, text_spacing * layout->scale, sub_text);
+        int sub_width = sub_label.measured.x;
+        wrzDrawLabel(&sub_label, (Vector2) { (int) sub_at.x - sub_width / 2, sub_at.y }, text_color);
+    }
+}
+
+// the counters overlay, toggled with F1
+void wrzDrawCounters(const wrzLayout * layout, Font font, float text_spacing, Color bgc, Color txtc) {
+    wrzStat * frame = &wrz_counters.gui.frame_time;
+    wrzStat * present = &wrz_counters.gui.present_error;
+    wrzStat * callback = &wrz_counters.audio.callback_time;
+    wrzStat * margin = &wrz_counters.audio.deadline_margin;
+    wrzStat * offset = &wrz_counters.audio.click_offset;
+
+    Rectangle panel = layout->rects[WRZ_UI_COUNTERS];
+    float s = layout->scale;
+    DrawRectangleRec(panel, Fade(bgc, 0.85f));
+
+    // TextFormat() only has a few buffers to cycle through, so each line is drawn as soon as it is formatted
+    DrawTextEx(font, TextFormat("frame      %6.2f ms  (max %6.2f)", atomic_load(&frame->last), atomic_load(&frame->max)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 0) * s }, 20 * s, text_spacing * s / 2, txtc);
+    DrawTextEx(font, TextFormat("present    %+6.2f ms  (max %6.2f)", atomic_load(&present->last), atomic_load(&present->max)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 1) * s }, 20 * s, text_spacing * s / 2, txtc);
+    DrawTextEx(font, TextFormat("callback   %6.3f ms  (max %6.3f)", atomic_load(&callback->last), atomic_load(&callback->max)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 2) * s }, 20 * s, text_spacing * s / 2, txtc);
+    DrawTextEx(font, TextFormat("margin     %6.2f ms  (min %6.2f)", atomic_load(&margin->last), atomic_load(&margin->min)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 3) * s }, 20 * s, text_spacing * s / 2, txtc);
+    DrawTextEx(font, TextFormat("click off. %6.3f ms  (max %6.3f)", atomic_load(&offset->last), atomic_load(&offset->max)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 4) * s }, 20 * s, text_spacing * s / 2, txtc);
+    DrawTextEx(font, TextFormat("underruns  %lld", atomic_load(&wrz_counters.audio.underruns)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 5) * s }, 20 * s, text_spacing * s / 2, txtc);
+    DrawTextEx(font, TextFormat("allocs     %lld gui, %lld audio  (%lld/%lld steady)", atomic_load(&wrz_counters.gui.allocations), atomic_load(&wrz_counters.audio.allocations),
+        atomic_load(&wrz_counters.gui.allocating_frames), atomic_load(&wrz_counters.audio.allocating_callbacks)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 6) * s }, 20 * s, text_spacing * s / 2, txtc);
+    DrawTextEx(font, TextFormat("sync err.  %+6.3f ms  (%lld packets)", atomic_load(&wrz_counters.sync.phase_error.last), atomic_load(&wrz_counters.sync.packets)), (Vector2) { panel.x + 10 * s, panel.y + (5 + 24 * 7) * s }, 20 * s, text_spacing * s / 2, txtc);
+}
+
+//------------------------------------------------------------------------------
+
+// fills in everything the next frame reads from the window and the other threads, they aren't asked anything during the frame itself
+// `tracker` is NULL unless it is running
+void wrzReadFrameInput(wrzFrameInput * in, wrzFramePacer * pacer, int refresh_rate, wrzTapInput * taps, wrzBeatTracker * tracker, wrzSync * sync, wrzAudioOutput * output) {
+    memset(in, 0, sizeof(wrzFrameInput));
+
+    in->now = wrzNow();
+    in->present_time = wrzPredictPresentTime(pacer, refresh_rate); // everything that moves is drawn as it will be then, not as it is now
+    in->frame_time = GetFrameTime();
+    in->width = GetScreenWidth();
+    in->height = GetScreenHeight();
+    in->dpi = GetWindowScaleDPI().x;
+
+    in->mouse = GetMousePosition();
+    in->wheel = GetMouseWheelMove();
+    for(int b = 0; b < WRZ_INPUT_BUTTONS; b++) if(IsMouseButtonDown(b)) in->buttons |= 1u << b;
+    for(int k = 1; k < WRZ_INPUT_KEYS; k++) if(IsKeyDown(k)) in->keys[k / 8] |= 1 << (k % 8);
+    while(in->char_count < WRZ_INPUT_CHARS && (in->chars[in->char_count] = GetCharPressed()) != 0) in->char_count++;
+
+    // taps from --tap-device carry the time they actually happened, the button and T only get the time of the frame they were seen in
+    while(in->tap_count < WRZ_INPUT_TAPS && wrzPopTap(taps, &in->taps[in->tap_count])) in->tap_count++;
+
+    if(tracker != NULL) {
+        in->tracker_estimates = atomic_load(&tracker->estimates);
+        in->tracker_bpm = atomic_load(&tracker->bpm);
+        in->tracker_beat = atomic_load(&tracker->beat_time);
+    }
+
+    in->have_leader = !sync->leading && atomic_load(&sync->have_leader);
+    in->leader_bpm = atomic_load(&sync->bpm);
+    in->leader_subdivision = atomic_load(&sync->subdivision);
+
+    in->transport_rolling = atomic_load(&output->transport_rolling);
+    in->transport_bpm = atomic_load(&output->transport_bpm);
+
+    in->underruns = atomic_load(&wrz_counters.audio.underruns);
+}
+
+// once the window is open, `style_filepath` is NULL for raygui's default style
+void wrzOpenGui(wrzGui * g, wrzSession * session, const char * style_filepath) {
+    memset(g, 0, sizeof(wrzGui));
+    g->session = session;
+
+    // if there is a specified style in the config file, use it
+    if(style_filepath != NULL) GuiLoadStyle(style_filepath);
+    // else, use the default one, wrzLoadProgramConfig() sets the value to NULL if the file does not exist/is not specified
+
+    // pre-get the colors to pass to the draw functions, because these need not be read more than once
+    g->clear_color = GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR));
+    g->fill_color = GetColor(GuiGetStyle(DEFAULT, BASE_COLOR_NORMAL));
+    g->text_color = GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_NORMAL));
+
+    g->font = GuiGetFont(); // pre-load the font as were the colors above
+    g->text_spacing = GuiGetStyle(DEFAULT, TEXT_SPACING); // pre-load as above
+
+    if(style_filepath == NULL) g->text_spacing *= 2; // this is just to fix the default style's spacing being too small for my eyes
+
+    // prepare speed input buffer
+    g->input_buffer_size = 16; // room for something like "123.456789" and then some
+    g->input_buffer = malloc(g->input_buffer_size);
+    memset(g->input_buffer, '\0', g->input_buffer_size); // memset to avoid funny business
+}
+
+// the first half of a frame: the widgets, and handing what they were set to over to the click engine. the frame is drawn from
+// BeginDrawing() in here to EndDrawing() in wrzGuiFrameEnd(), and --replay renders the blocks the audio thread got through in between
+void wrzGuiFrameBegin(wrzGui * g, const wrzFrameInput * input) {
+    wrz_last_frame_input = wrz_frame_input;
+    wrz_frame_input = *input;
+    wrz_frame_input.chars_taken = 0;
+
+    wrzSession * session = g->session;
+    wrzClickEngine * engine = &session->engine;
+
+    if(wrzIsKeyPressed(KEY_F1)) g->show_counters = !g->show_counters;
+    if(wrzIsKeyPressed(KEY_F2) && g->midi_export_path != NULL) wrzExportMidiFile(g->midi_export_path, session->bpm, session->subdivision);
+
+    wrzRecordStat(&wrz_counters.gui.frame_time, input->frame_time * 1000.0);
+
+    g->relaid = false; // a new layout loads new fonts, which is allowed to allocate
+    if(wrzUpdateLayout(&g->layout)) {
+        g->relaid = true;
+        GuiSetStyle(DEFAULT, TEXT_SIZE, (int) (20 * g->layout.scale)); // raygui, set the style's text size to 20 at WIDTH x HEIGHT
+
+        if(g->bpm_digits.texture.id != 0) UnloadFont(g->bpm_digits);
+        if(g->sub_bpm_digits.texture.id != 0) UnloadFont(g->sub_bpm_digits);
+        g->bpm_digits = wrzLoadDigitFont(g->font, (int) (g->layout.rects[WRZ_UI_BPM_TEXT].height * g->layout.dpi));
+        g->sub_bpm_digits = wrzLoadDigitFont(g->font, (int) (g->layout.rects[WRZ_UI_SUB_BPM_TEXT].height * g->layout.dpi));
+    }
+
+    g->draw_start = wrzTraceBegin();
+
+    BeginDrawing();
+
+        ClearBackground(g->clear_color);
+
+        //------------------------------------------------------------------------------
+
+        wrzSpeedSelectionButtons(&g->layout, &session->bpm); // draw speed selection buttons below background triangle + get bpm
+
+        wrzDrawStaticElements(&g->layout, g->font, g->text_spacing, g->clear_color, g->fill_color, g->text_color, input->underruns); // draw the title and background triangle
+
+        wrzSpeedSelectionSlider(&g->layout, &session->bpm); // draw the slider + get/set bpm
+
+        wrzSpeedInputBox(&g->layout, &g->input_buffer, g->input_buffer_size, &session->bpm); // draw the text input box + get/set bpm
+
+        wrzSubdivisionSelectionButton(&g->layout, &session->subdivision); // draw the subdivision button + get subdivision
+
+        // beat change is 0 normally, 1 if the primary has changed, and 2 if the secondary has changed
+        int beat_change = wrzSelectBeatSounds(&g->layout, &session->beat_idx, &session->sub_beat_idx, session->sounds->count);
+
+        //------------------------------------------------------------------------------
+
+        bool tapped = false;
+        for(int i = 0; i < input->tap_count; i++) tapped = wrzTap(&g->tap_tempo, input->taps[i]) || tapped;
+        if(wrzTapTempoButton(&g->layout)) tapped = wrzTap(&g->tap_tempo, input->now) || tapped;
+
+        if(tapped) session->bpm = fmin(fmax(60.0 / g->tap_tempo.period, 1.0), WRZ_MAX_BPM);
+
+        g->tracked_beat = 0.0;
+        if(input->tracker_estimates != g->tracker_estimates) {
+            g->tracker_estimates = input->tracker_estimates;
+            session->bpm = input->tracker_bpm;
+            g->tracked_beat = input->tracker_beat;
+        }
+
+        // a follower plays whatever the leader plays, no matter what was clicked
+        if(input->have_leader) {
+            session->bpm = input->leader_bpm;
+            session->subdivision = input->leader_subdivision;
+        }
+
+        // the daw's tempo wins while it is playing, and nothing clicks while it is stopped
+        if(g->transport_following && input->transport_rolling) session->bpm = input->transport_bpm;
+
+        //------------------------------------------------------------------------------
+
+        // odd until wrzGuiFrameEnd() has handed over everything from this frame, so --record can tell which frame a block's values are from
+        atomic_fetch_add(&engine->gui_frame, 1);
+
+        // it should not be possible to click both buttons in the same frame
+        if(beat_change == 2) { // the second beat button has been changed
+            atomic_store(&engine->sub_beat_idx, session->sub_beat_idx);
+        } else if(beat_change == 1) { // the first beat button has been changed
+            atomic_store(&engine->beat_idx, session->beat_idx);
+        } // else, no change
+
+        // hand the tempo to the click engine, which schedules the clicks on the audio thread
+        if(!g->transport_following) atomic_store(&engine->bpm, session->bpm);
+        atomic_store(&engine->subdivision, session->subdivision);
+        if(tapped) atomic_store(&engine->phase_anchor, g->tap_tempo.phase); // after the tempo it goes with, and the engine reads them the other way around
+}
+
+// the second half: reads the beat clock, draws the pulse from it, and puts the frame on screen
+void wrzGuiFrameEnd(wrzGui * g) {
+    wrzSession * session = g->session;
+    wrzClickEngine * engine = &session->engine;
+
+        // the pulse follows what will be coming out of the speakers when this frame is on screen, not what the engine has just rendered
+        wrzReadBeatClock(engine, &g->beat_clock);
+
+        // the tracked beat moves the clicks only if they are audibly off it, otherwise every estimate would shuffle them around a little
+        if(g->tracked_beat > 0.0) {
+            double position = wrzBeatPositionIn(&g->beat_clock, g->tracked_beat);
+            if(!isnan(position) && fabs(position - round(position)) * 60.0 / session->bpm > WRZ_TRACK_PHASE_TOLERANCE) {
+                atomic_store(&engine->phase_anchor, g->tracked_beat);
+            }
+        }
+
+        atomic_fetch_add(&engine->gui_frame, 1); // even again, see wrzGuiFrameBegin()
+
+        double beat = wrzBeatPositionIn(&g->beat_clock, wrz_frame_input.present_time);
+        g->hash = wrzHashFrame(g, beat);
+
+        wrzBeatAnimation(&g->layout, beat, session->subdivision); // play the beating animation
+
+        wrzDrawBPM(&g->layout, session->bpm, session->subdivision, g->bpm_digits, g->sub_bpm_digits, g->text_spacing, g->text_color); // draw the bpm text over the beating animation
+
+        if(g->show_counters) wrzDrawCounters(&g->layout, g->font, g->text_spacing, g->clear_color, g->text_color);
+
+        double end_drawing_start = wrzTraceBegin();
+        wrzTraceEnd("draw", g->draw_start, NULL, 0);
+
+    EndDrawing(); // swaps buffers, polls input and waits for the next frame
+
+    wrzTraceEnd("EndDrawing", end_drawing_start, NULL, 0);
+}
+
+void wrzCloseGui(wrzGui * g) {
+    free(g->input_buffer); // free the input buffer that is used by wrzSpeedInputBox()
+
+    UnloadFont(g->bpm_digits);
+    UnloadFont(g->sub_bpm_digits);
+}